@@ -13,7 +13,9 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include "angle_bch.h"
+#include "compute_bonded_hist.h"
 #include "atom.h"
 #include "neighbor.h"
 #include "domain.h"
@@ -22,6 +24,9 @@
 #include "math_const.h"
 #include "memory.h"
 #include "error.h"
+#include "utils.h"
+#include "fixed_point.h"
+#include "rigid_body.h"
 
 using namespace LAMMPS_NS;
 using namespace MathConst;
@@ -33,6 +38,25 @@ using namespace MathConst;
 AngleBCH::AngleBCH(LAMMPS *lmp) : Angle(lmp)
 {
   epsilon = NULL;
+
+  gam = 0.1;
+  k1 = 106.4;
+  k2 = 26.3;
+  t1 = 1.60;
+  t2 = 2.27;
+
+  num_tally_compute = 0;
+  list_tally_compute = NULL;
+
+  timeflag = 0;
+  time_compute = 0.0;
+
+  fixedflag = 0;
+  ffix = NULL;
+  nmax_fix = 0;
+
+  idbody = NULL;
+  ibody = -1;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -43,6 +67,9 @@ AngleBCH::~AngleBCH()
     memory->destroy(setflag);
     memory->destroy(epsilon);
   }
+  memory->sfree(list_tally_compute);
+  memory->destroy(ffix);
+  delete [] idbody;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -56,6 +83,9 @@ void AngleBCH::compute(int eflag, int vflag)
   double dlog1,dlog2,dexp1,dexp2,df1,df2;
   double rsq1,rsq2,r1,r2,c,s,a,a11,a12,a22;
 
+  double time_start = 0.0;
+  if (timeflag) time_start = MPI_Wtime();
+
   eangle = 0.0;
   if (eflag || vflag) ev_setup(eflag,vflag);
   else evflag = 0;
@@ -65,13 +95,24 @@ void AngleBCH::compute(int eflag, int vflag)
   int **anglelist = neighbor->anglelist;
   int nanglelist = neighbor->nanglelist;
   int nlocal = atom->nlocal;
+  int nall = nlocal + atom->nghost;
   int newton_bond = force->newton_bond;
 
-  double gam = 0.1;
-  double k1 = 106.4;
-  double k2 = 26.3;
-  double t1 = 1.60;
-  double t2 = 2.27;
+  // deterministic mode: sum forces as fixed-point integers, add to f at end
+
+  bigint **ff = NULL;
+  int oflow = 0;
+  if (fixedflag) {
+    FixedPoint::setup(memory,ffix,nmax_fix,atom->nmax,nall,"angle:ffix");
+    ff = ffix;
+  }
+
+  for (int k = 0; k < num_tally_compute; k++)
+    list_tally_compute[k]->bonded_setup_callback();
+
+  // angles with all atoms in the same rigid body are skipped
+
+  int *body = idbody ? atom->ivector[ibody] : NULL;
 
   for (n = 0; n < nanglelist; n++) {
     i1 = anglelist[n][0];
@@ -79,6 +120,9 @@ void AngleBCH::compute(int eflag, int vflag)
     i3 = anglelist[n][2];
     type = anglelist[n][3];
 
+    if (body && body[i2] && body[i1] == body[i2] && body[i3] == body[i2])
+      continue;
+
     // 1st bond
 
     delx1 = x[i1][0] - x[i2][0];
@@ -116,6 +160,11 @@ void AngleBCH::compute(int eflag, int vflag)
     e0a = -gam * epsilon[type];
 
     theta = acos(c);
+
+    for (int k = 0; k < num_tally_compute; k++)
+      list_tally_compute[k]->angle_tally_callback(i1,i2,i3,nlocal,
+                                                  newton_bond,theta);
+
     dtheta1 = theta - t1;
     dtheta2 = theta - t2;
     tk1 = -k1a * dtheta1;
@@ -146,27 +195,74 @@ void AngleBCH::compute(int eflag, int vflag)
 
     // apply force to each of 3 atoms
 
-    if (newton_bond || i1 < nlocal) {
-      f[i1][0] += f1[0];
-      f[i1][1] += f1[1];
-      f[i1][2] += f1[2];
-    }
-
-    if (newton_bond || i2 < nlocal) {
-      f[i2][0] -= f1[0] + f3[0];
-      f[i2][1] -= f1[1] + f3[1];
-      f[i2][2] -= f1[2] + f3[2];
-    }
-
-    if (newton_bond || i3 < nlocal) {
-      f[i3][0] += f3[0];
-      f[i3][1] += f3[1];
-      f[i3][2] += f3[2];
+    if (fixedflag) {
+      if (newton_bond || i1 < nlocal)
+        FixedPoint::add(ff[i1],f1[0],f1[1],f1[2],oflow);
+      if (newton_bond || i2 < nlocal)
+        FixedPoint::sub(ff[i2],f1[0]+f3[0],f1[1]+f3[1],f1[2]+f3[2],oflow);
+      if (newton_bond || i3 < nlocal)
+        FixedPoint::add(ff[i3],f3[0],f3[1],f3[2],oflow);
+    } else {
+      if (newton_bond || i1 < nlocal) {
+        f[i1][0] += f1[0];
+        f[i1][1] += f1[1];
+        f[i1][2] += f1[2];
+      }
+
+      if (newton_bond || i2 < nlocal) {
+        f[i2][0] -= f1[0] + f3[0];
+        f[i2][1] -= f1[1] + f3[1];
+        f[i2][2] -= f1[2] + f3[2];
+      }
+
+      if (newton_bond || i3 < nlocal) {
+        f[i3][0] += f3[0];
+        f[i3][1] += f3[1];
+        f[i3][2] += f3[2];
+      }
     }
 
     if (evflag) ev_tally(i1,i2,i3,nlocal,newton_bond,eangle,f1,f3,
                          delx1,dely1,delz1,delx2,dely2,delz2);
   }
+
+  if (fixedflag) {
+    if (oflow) error->one(FLERR,"Force too large for fixed-point summation");
+    FixedPoint::flush(f,ffix,nall);
+  }
+
+  if (timeflag) time_compute += MPI_Wtime() - time_start;
+}
+
+/* ----------------------------------------------------------------------
+   register a compute that is fed theta of every angle from compute()
+------------------------------------------------------------------------- */
+
+void AngleBCH::add_tally_callback(ComputeBondedHist *ptr)
+{
+  for (int i = 0; i < num_tally_compute; i++)
+    if (list_tally_compute[i] == ptr) return;
+
+  num_tally_compute++;
+  list_tally_compute = (ComputeBondedHist **)
+    memory->srealloc(list_tally_compute,
+                     num_tally_compute*sizeof(ComputeBondedHist *),
+                     "angle:list_tally_compute");
+  list_tally_compute[num_tally_compute-1] = ptr;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AngleBCH::del_tally_callback(ComputeBondedHist *ptr)
+{
+  int found = -1;
+  for (int i = 0; i < num_tally_compute; i++)
+    if (list_tally_compute[i] == ptr) found = i;
+  if (found < 0) return;
+
+  num_tally_compute--;
+  for (int i = found; i < num_tally_compute; i++)
+    list_tally_compute[i] = list_tally_compute[i+1];
 }
 
 /* ---------------------------------------------------------------------- */
@@ -182,6 +278,48 @@ void AngleBCH::allocate()
   for (int i = 1; i <= n; i++) setflag[i] = 0;
 }
 
+/* ----------------------------------------------------------------------
+   global settings, optional keyword/value pairs for the shape constants
+   e.g. as written by FitBondedParam, and fixed yes/no for deterministic
+   fixed-point force summation, rigid i_name to skip terms inside a body
+------------------------------------------------------------------------- */
+
+void AngleBCH::settings(int narg, char **arg)
+{
+  if (narg % 2) error->all(FLERR,"Illegal angle_style command");
+
+  fixedflag = 0;
+  delete [] idbody;
+  idbody = NULL;
+
+  for (int iarg = 0; iarg < narg; iarg += 2) {
+    if (strcmp(arg[iarg],"fixed") == 0) {
+      if (strcmp(arg[iarg+1],"yes") == 0) fixedflag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) fixedflag = 0;
+      else error->all(FLERR,"Illegal angle_style command");
+      continue;
+    }
+    if (strcmp(arg[iarg],"rigid") == 0) {
+      if (strncmp(arg[iarg+1],"i_",2) != 0)
+        error->all(FLERR,"Illegal angle_style command");
+      delete [] idbody;
+      idbody = new char[strlen(arg[iarg+1])-1];
+      strcpy(idbody,&arg[iarg+1][2]);
+      continue;
+    }
+
+    double value = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+    if (strcmp(arg[iarg],"gam") == 0) gam = value;
+    else if (strcmp(arg[iarg],"k1") == 0) k1 = value;
+    else if (strcmp(arg[iarg],"k2") == 0) k2 = value;
+    else if (strcmp(arg[iarg],"t1") == 0) t1 = value;
+    else if (strcmp(arg[iarg],"t2") == 0) t2 = value;
+    else error->all(FLERR,"Illegal angle_style command");
+  }
+
+  if (gam <= 0.0) error->all(FLERR,"Illegal angle_style command");
+}
+
 /* ----------------------------------------------------------------------
    set coeffs for one or more types
 ------------------------------------------------------------------------- */
@@ -206,6 +344,18 @@ void AngleBCH::coeff(int narg, char **arg)
   if (count == 0) error->all(FLERR,"Incorrect args for angle coefficients");
 }
 
+/* ----------------------------------------------------------------------
+   timings follow the LAMMPS breakdown, which is reset for every run
+------------------------------------------------------------------------- */
+
+void AngleBCH::init_style()
+{
+  time_compute = 0.0;
+
+  if (idbody)
+    ibody = RigidBody::find(atom,modify,error,idbody,"angle_style bch");
+}
+
 /* ---------------------------------------------------------------------- */
 
 double AngleBCH::equilibrium_angle(int i)
@@ -219,6 +369,7 @@ double AngleBCH::equilibrium_angle(int i)
 
 void AngleBCH::write_restart(FILE *fp)
 {
+  write_restart_settings(fp);
   fwrite(&epsilon[1],sizeof(double),atom->nangletypes,fp);
 }
 
@@ -228,6 +379,7 @@ void AngleBCH::write_restart(FILE *fp)
 
 void AngleBCH::read_restart(FILE *fp)
 {
+  read_restart_settings(fp);
   allocate();
 
   if (comm->me == 0) {
@@ -238,6 +390,44 @@ void AngleBCH::read_restart(FILE *fp)
   for (int i = 1; i <= atom->nangletypes; i++) setflag[i] = 1;
 }
 
+/* ----------------------------------------------------------------------
+   proc 0 writes out shape constants and fixed/rigid settings to restart file
+------------------------------------------------------------------------- */
+
+void AngleBCH::write_restart_settings(FILE *fp)
+{
+  fwrite(&gam,sizeof(double),1,fp);
+  fwrite(&k1,sizeof(double),1,fp);
+  fwrite(&k2,sizeof(double),1,fp);
+  fwrite(&t1,sizeof(double),1,fp);
+  fwrite(&t2,sizeof(double),1,fp);
+  fwrite(&fixedflag,sizeof(int),1,fp);
+  RigidBody::write(fp,idbody);
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 reads shape constants and fixed/rigid settings from restart file, bcasts
+------------------------------------------------------------------------- */
+
+void AngleBCH::read_restart_settings(FILE *fp)
+{
+  if (comm->me == 0) {
+    utils::sfread(FLERR,&gam,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&k1,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&k2,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&t1,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&t2,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&fixedflag,sizeof(int),1,fp,NULL,error);
+  }
+  MPI_Bcast(&gam,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&k1,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&k2,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&t1,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&t2,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&fixedflag,1,MPI_INT,0,world);
+  RigidBody::read(fp,idbody,comm->me,world,error);
+}
+
 /* ----------------------------------------------------------------------
    proc 0 writes to data file
 ------------------------------------------------------------------------- */
@@ -272,13 +462,13 @@ double AngleBCH::single(int type, int i1, int i2, int i3)
   if (c < -1.0) c = -1.0;
 
   double theta = acos(c);
-  double dtheta1 = theta - 1.60;
-  double dtheta2 = theta - 2.27;
-  double tk1 = -0.1 * 106.4 * dtheta1;
-  double tk2 = -0.1 * 26.3 * dtheta2;
+  double dtheta1 = theta - t1;
+  double dtheta2 = theta - t2;
+  double tk1 = -gam * k1 * dtheta1;
+  double tk2 = -gam * k2 * dtheta2;
   tk1 *= dtheta1;
   tk2 *= dtheta2;
-  double dexp1 = exp(tk1 - 0.1*epsilon[type]);
+  double dexp1 = exp(tk1 - gam*epsilon[type]);
   double dexp2 = exp(tk2);
-  return -log(dexp1 + dexp2)/0.1;
+  return -log(dexp1 + dexp2)/gam;
 }
@@ -30,15 +30,36 @@ class AngleBCH : public Angle {
   AngleBCH(class LAMMPS *);
   virtual ~AngleBCH();
   virtual void compute(int, int);
+  virtual void settings(int, char **);
   virtual void coeff(int, char **);
   double equilibrium_angle(int);
   void write_restart(FILE *);
   virtual void read_restart(FILE *);
+  void write_restart_settings(FILE *);
+  void read_restart_settings(FILE *);
+  void init_style();
   void write_data(FILE *);
   double single(int, int, int, int);
 
+  void add_tally_callback(class ComputeBondedHist *);
+  void del_tally_callback(class ComputeBondedHist *);
+
+  int timeflag;                // 1 if compute() is timed
+  double time_compute;         // wall time spent in compute() this run
+
  protected:
   double *epsilon;
+  double gam,k1,k2,t1,t2;      // shape of the two-well potential
+
+  int num_tally_compute;
+  class ComputeBondedHist **list_tally_compute;
+
+  int fixedflag;               // 1 = deterministic fixed-point forces
+  bigint **ffix;
+  int nmax_fix;
+
+  char *idbody;                // i_name of the rigid body ID, NULL = none
+  int ibody;
 
   virtual void allocate();
 };
@@ -50,8 +71,28 @@ class AngleBCH : public Angle {
 
 /* ERROR/WARNING messages:
 
+E: Illegal angle_style command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
 E: Incorrect args for angle coefficients
 
 Self-explanatory.  Check the input script or data file.
 
+E: Rigid body property for angle_style bch does not exist
+
+The rigid keyword needs an integer per-atom property, e.g. defined by
+fix property/atom i_body ghost yes.
+
+E: Rigid body property for angle_style bch needs fix property/atom ghost yes
+
+Body IDs of ghost atoms are used, so the property must be defined by
+a fix property/atom with ghost yes.
+
+E: Force too large for fixed-point summation
+
+With fixed yes a single force component must stay below 2^20
+kcal/mol/Angstrom (or is NaN).  Minimize first or use fixed no.
+
 */
@@ -0,0 +1,235 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include <cstring>
+#include "compute_bonded_hist.h"
+#include "angle_bch.h"
+#include "dihedral_gaussian.h"
+#include "atom.h"
+#include "update.h"
+#include "force.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+
+enum{ANGLE,DIHEDRAL};
+enum{TYPE,POSITION};
+
+/* ----------------------------------------------------------------------
+   compute ID group bonded/hist angle|dihedral nbin type|position
+           keyword value ...
+     every N = tally on timesteps that are a multiple of N
+     chain N = residues per chain, position keys are folded by N
+------------------------------------------------------------------------- */
+
+ComputeBondedHist::ComputeBondedHist(LAMMPS *lmp, int narg, char **arg) :
+  Compute(lmp, narg, arg),
+  hist(NULL), histall(NULL)
+{
+  if (narg < 6) error->all(FLERR,"Illegal compute bonded/hist command");
+
+  if (strcmp(arg[3],"angle") == 0) which = ANGLE;
+  else if (strcmp(arg[3],"dihedral") == 0) which = DIHEDRAL;
+  else error->all(FLERR,"Illegal compute bonded/hist command");
+
+  nbin = utils::inumeric(FLERR,arg[4],false,lmp);
+  if (nbin < 1) error->all(FLERR,"Illegal compute bonded/hist command");
+
+  if (strcmp(arg[5],"type") == 0) keyflag = TYPE;
+  else if (strcmp(arg[5],"position") == 0) keyflag = POSITION;
+  else error->all(FLERR,"Illegal compute bonded/hist command");
+
+  nevery = 1;
+  chain = atom->natoms;
+
+  int iarg = 6;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"every") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal compute bonded/hist command");
+      nevery = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      if (nevery < 1) error->all(FLERR,"Illegal compute bonded/hist command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"chain") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal compute bonded/hist command");
+      chain = utils::bnumeric(FLERR,arg[iarg+1],false,lmp);
+      if (chain < 1) error->all(FLERR,"Illegal compute bonded/hist command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal compute bonded/hist command");
+  }
+
+  if (keyflag == TYPE) nkey = atom->ntypes;
+  else {
+    if (chain > MAXSMALLINT)
+      error->all(FLERR,"Too many residues per chain in compute bonded/hist");
+    nkey = static_cast<int> (chain);
+  }
+
+  // theta in [0,pi], phi in [-pi,pi], same convention as the styles
+
+  if (which == ANGLE) {
+    lo = 0.0;
+    hi = MY_PI;
+  } else {
+    lo = -MY_PI;
+    hi = MY_PI;
+  }
+  binsize = (hi-lo)/nbin;
+  bininv = 1.0/binsize;
+
+  array_flag = 1;
+  size_array_rows = nbin;
+  size_array_cols = nkey + 1;
+  extarray = 0;
+
+  memory->create(hist,nbin,nkey,"bonded/hist:hist");
+  memory->create(histall,nbin,nkey,"bonded/hist:histall");
+  memory->create(array,nbin,nkey+1,"bonded/hist:array");
+
+  for (int m = 0; m < nbin; m++)
+    for (int k = 0; k < nkey; k++) hist[m][k] = 0.0;
+
+  lasttally = -1;
+  active = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeBondedHist::~ComputeBondedHist()
+{
+  if (force) {
+    if (which == ANGLE) {
+      AngleBCH *angle = dynamic_cast<AngleBCH *>(force->angle_match("bch"));
+      if (angle) angle->del_tally_callback(this);
+    } else {
+      DihedralGaussian *dihedral =
+        dynamic_cast<DihedralGaussian *>(force->dihedral_match("gaussian"));
+      if (dihedral) dihedral->del_tally_callback(this);
+    }
+  }
+
+  memory->destroy(hist);
+  memory->destroy(histall);
+  memory->destroy(array);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeBondedHist::init()
+{
+  // (re)register with the style, it may have been re-created since
+
+  if (which == ANGLE) {
+    AngleBCH *angle = dynamic_cast<AngleBCH *>(force->angle_match("bch"));
+    if (!angle) error->all(FLERR,"Compute bonded/hist requires angle style bch");
+    angle->add_tally_callback(this);
+  } else {
+    DihedralGaussian *dihedral =
+      dynamic_cast<DihedralGaussian *>(force->dihedral_match("gaussian"));
+    if (!dihedral)
+      error->all(FLERR,"Compute bonded/hist requires dihedral style gaussian");
+    dihedral->add_tally_callback(this);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   called once per compute() of the bonded style
+   a timestep is only tallied once, even if forces are recomputed
+------------------------------------------------------------------------- */
+
+void ComputeBondedHist::bonded_setup_callback()
+{
+  bigint ntimestep = update->ntimestep;
+  active = 0;
+  if (ntimestep % nevery) return;
+  if (ntimestep == lasttally) return;
+  lasttally = ntimestep;
+  active = 1;
+}
+
+/* ----------------------------------------------------------------------
+   each angle is counted once: by the owner of i2 when newton_bond is off
+------------------------------------------------------------------------- */
+
+void ComputeBondedHist::angle_tally_callback(int /*i1*/, int i2, int /*i3*/,
+                                             int nlocal, int newton_bond,
+                                             double theta)
+{
+  if (!active) return;
+  if (!newton_bond && i2 >= nlocal) return;
+  if (!(atom->mask[i2] & groupbit)) return;
+  tally(i2,theta);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeBondedHist::dihedral_tally_callback(int /*i1*/, int i2,
+                                                int /*i3*/, int /*i4*/,
+                                                int nlocal, int newton_bond,
+                                                double phi)
+{
+  if (!active) return;
+  if (!newton_bond && i2 >= nlocal) return;
+  if (!(atom->mask[i2] & groupbit)) return;
+  tally(i2,phi);
+}
+
+/* ----------------------------------------------------------------------
+   bin value for the residue of atom i
+------------------------------------------------------------------------- */
+
+void ComputeBondedHist::tally(int i, double value)
+{
+  int ikey;
+  if (keyflag == TYPE) ikey = atom->type[i] - 1;
+  else ikey = static_cast<int> ((atom->tag[i]-1) % chain);
+
+  int ibin = static_cast<int> ((value-lo)*bininv);
+  ibin = MAX(ibin,0);
+  ibin = MIN(ibin,nbin-1);
+  hist[ibin][ikey] += 1.0;
+}
+
+/* ----------------------------------------------------------------------
+   column 1 = bin center, columns 2..nkey+1 = normalized density per key
+------------------------------------------------------------------------- */
+
+void ComputeBondedHist::compute_array()
+{
+  invoked_array = update->ntimestep;
+
+  MPI_Allreduce(&hist[0][0],&histall[0][0],nbin*nkey,MPI_DOUBLE,MPI_SUM,world);
+
+  for (int m = 0; m < nbin; m++) array[m][0] = lo + (m+0.5)*binsize;
+
+  double norm;
+  for (int k = 0; k < nkey; k++) {
+    norm = 0.0;
+    for (int m = 0; m < nbin; m++) norm += histall[m][k];
+    if (norm > 0.0) norm = bininv/norm;
+    for (int m = 0; m < nbin; m++) array[m][k+1] = histall[m][k]*norm;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+double ComputeBondedHist::memory_usage()
+{
+  double bytes = 2.0 * nbin*nkey * sizeof(double);
+  bytes += nbin*(nkey+1) * sizeof(double);
+  return bytes;
+}
@@ -0,0 +1,75 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Histograms of the CA pseudo-angle (bch) or pseudo-dihedral (gaussian)
+   tallied from inside AngleBCH::compute() / DihedralGaussian::compute()
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(bonded/hist,ComputeBondedHist)
+
+#else
+
+#ifndef LMP_COMPUTE_BONDED_HIST_H
+#define LMP_COMPUTE_BONDED_HIST_H
+
+#include "compute.h"
+
+namespace LAMMPS_NS {
+
+class ComputeBondedHist : public Compute {
+ public:
+  ComputeBondedHist(class LAMMPS *, int, char **);
+  ~ComputeBondedHist();
+  void init();
+  void compute_array();
+  double memory_usage();
+
+  void bonded_setup_callback();
+  void angle_tally_callback(int, int, int, int, int, double);
+  void dihedral_tally_callback(int, int, int, int, int, int, double);
+
+ protected:
+  int which;                 // ANGLE or DIHEDRAL
+  int keyflag;               // TYPE or POSITION
+  int nbin,nkey,nevery;
+  bigint chain;              // residues per chain for POSITION keys
+  bigint lasttally;
+  int active;
+  double lo,hi,binsize,bininv;
+  double **hist,**histall;
+
+  void tally(int, double);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Compute bonded/hist requires angle style bch
+
+The histogram is tallied from inside AngleBCH::compute().
+
+E: Compute bonded/hist requires dihedral style gaussian
+
+The histogram is tallied from inside DihedralGaussian::compute().
+
+*/
@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include "compute_bonded_timing.h"
+#include "angle_bch.h"
+#include "dihedral_gaussian.h"
+#include "update.h"
+#include "force.h"
+#include "timer.h"
+#include "comm.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+
+/* ----------------------------------------------------------------------
+   compute ID all bonded/timing
+   vector = bch time, gaussian time, bch share of Bond, gaussian share of Bond
+   times are wall seconds of the current run, averaged over procs
+------------------------------------------------------------------------- */
+
+ComputeBondedTiming::ComputeBondedTiming(LAMMPS *lmp, int narg, char **arg) :
+  Compute(lmp, narg, arg),
+  angle(NULL), dihedral(NULL)
+{
+  if (narg != 3) error->all(FLERR,"Illegal compute bonded/timing command");
+
+  vector_flag = 1;
+  size_vector = 4;
+  extvector = 0;
+
+  vector = new double[size_vector];
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeBondedTiming::~ComputeBondedTiming()
+{
+  // the styles may already be gone or re-created, look them up again
+
+  if (force) {
+    AngleBCH *a = dynamic_cast<AngleBCH *>(force->angle_match("bch"));
+    if (a) a->timeflag = 0;
+    DihedralGaussian *d =
+      dynamic_cast<DihedralGaussian *>(force->dihedral_match("gaussian"));
+    if (d) d->timeflag = 0;
+  }
+
+  delete [] vector;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeBondedTiming::init()
+{
+  angle = dynamic_cast<AngleBCH *>(force->angle_match("bch"));
+  dihedral = dynamic_cast<DihedralGaussian *>(force->dihedral_match("gaussian"));
+
+  if (!angle && !dihedral && comm->me == 0)
+    error->warning(FLERR,"Compute bonded/timing found neither angle style "
+                   "bch nor dihedral style gaussian");
+
+  if (angle) angle->timeflag = 1;
+  if (dihedral) dihedral->timeflag = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeBondedTiming::compute_vector()
+{
+  invoked_vector = update->ntimestep;
+
+  double one[3],all[3];
+  one[0] = angle ? angle->time_compute : 0.0;
+  one[1] = dihedral ? dihedral->time_compute : 0.0;
+  one[2] = timer->get_wall(Timer::BOND);
+  MPI_Allreduce(one,all,3,MPI_DOUBLE,MPI_SUM,world);
+
+  vector[0] = all[0]/comm->nprocs;
+  vector[1] = all[1]/comm->nprocs;
+  vector[2] = vector[3] = 0.0;
+  if (all[2] > 0.0) {
+    vector[2] = all[0]/all[2];
+    vector[3] = all[1]/all[2];
+  }
+}
@@ -0,0 +1,58 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Splits the "Bond" row of the timing breakdown into the time spent in
+   AngleBCH::compute() and DihedralGaussian::compute()
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(bonded/timing,ComputeBondedTiming)
+
+#else
+
+#ifndef LMP_COMPUTE_BONDED_TIMING_H
+#define LMP_COMPUTE_BONDED_TIMING_H
+
+#include "compute.h"
+
+namespace LAMMPS_NS {
+
+class ComputeBondedTiming : public Compute {
+ public:
+  ComputeBondedTiming(class LAMMPS *, int, char **);
+  ~ComputeBondedTiming();
+  void init();
+  void compute_vector();
+
+ protected:
+  class AngleBCH *angle;
+  class DihedralGaussian *dihedral;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+W: Compute bonded/timing found neither angle style bch nor dihedral style gaussian
+
+All reported times will be zero.
+
+*/
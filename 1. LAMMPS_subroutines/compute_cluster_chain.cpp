@@ -0,0 +1,350 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cstring>
+#include "compute_cluster_chain.h"
+#include "atom.h"
+#include "update.h"
+#include "force.h"
+#include "pair.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "comm.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+
+/* ----------------------------------------------------------------------
+   lock-free union-find: roots only ever get linked below a smaller root
+   with a CAS, find() does path halving with CAS as well
+------------------------------------------------------------------------- */
+
+static inline int uf_find(int *parent, int x)
+{
+  int p = parent[x];
+  while (p != x) {
+    int gp = parent[p];
+    if (gp != p) __sync_bool_compare_and_swap(&parent[x],p,gp);
+    x = gp;
+    p = parent[x];
+  }
+  return x;
+}
+
+static inline void uf_union(int *parent, int a, int b)
+{
+  while (1) {
+    a = uf_find(parent,a);
+    b = uf_find(parent,b);
+    if (a == b) return;
+    if (a > b) { int tmp = a; a = b; b = tmp; }
+    if (__sync_bool_compare_and_swap(&parent[b],b,a)) return;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   compute ID group cluster/chain cutoff
+   vector = # of clusters, chains and atoms in the largest cluster
+   array  = row s: cluster size s (chains), # of clusters of that size
+   per-atom = 1 if the chain of the atom is in the largest cluster
+   chains of the group are in contact if any two of their atoms are
+   closer than cutoff
+   atoms with molecule ID 0 (ions, crowders) belong to no chain
+------------------------------------------------------------------------- */
+
+ComputeClusterChain::ComputeClusterChain(LAMMPS *lmp, int narg, char **arg) :
+  Compute(lmp, narg, arg),
+  parent(NULL), molcount(NULL), molcount_all(NULL), csize(NULL), catoms(NULL),
+  edges(NULL), edges_all(NULL), recvcounts(NULL), displs(NULL)
+{
+  if (narg != 4) error->all(FLERR,"Illegal compute cluster/chain command");
+
+  double cutoff = utils::numeric(FLERR,arg[3],false,lmp);
+  if (cutoff <= 0.0) error->all(FLERR,"Illegal compute cluster/chain command");
+  cutsq = cutoff*cutoff;
+
+  if (atom->molecule_flag == 0)
+    error->all(FLERR,"Compute cluster/chain requires molecule IDs");
+
+  vector_flag = 1;
+  size_vector = 3;
+  extvector = 0;
+
+  setup_molecules();
+
+  array_flag = 1;
+  size_array_rows = nmol;
+  size_array_cols = 2;
+  extarray = 0;
+
+  peratom_flag = 1;
+  size_peratom_cols = 0;
+
+  vector = new double[size_vector];
+  memory->create(array,nmol,2,"cluster/chain:array");
+  memory->create(recvcounts,comm->nprocs,"cluster/chain:recvcounts");
+  memory->create(displs,comm->nprocs,"cluster/chain:displs");
+
+  nmax = 0;
+  lastcompute = -1;
+  largest = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeClusterChain::~ComputeClusterChain()
+{
+  delete [] vector;
+  memory->destroy(array);
+  memory->destroy(parent);
+  memory->destroy(molcount);
+  memory->destroy(molcount_all);
+  memory->destroy(csize);
+  memory->destroy(catoms);
+  memory->destroy(edges);
+  memory->destroy(edges_all);
+  memory->destroy(recvcounts);
+  memory->destroy(displs);
+  memory->destroy(vector_atom);
+}
+
+/* ---------------------------------------------------------------------- */
+
+tagint ComputeClusterChain::max_molecule()
+{
+  tagint maxone = 0, maxall;
+  for (int i = 0; i < atom->nlocal; i++)
+    maxone = MAX(maxone,atom->molecule[i]);
+  MPI_Allreduce(&maxone,&maxall,1,MPI_LMP_TAGINT,MPI_MAX,world);
+  return maxall;
+}
+
+/* ----------------------------------------------------------------------
+   per-molecule arrays are indexed by molecule ID
+------------------------------------------------------------------------- */
+
+void ComputeClusterChain::setup_molecules()
+{
+  tagint maxall = max_molecule();
+  if (maxall >= MAXSMALLINT/2)
+    error->all(FLERR,"Too many molecules for compute cluster/chain");
+  nmol = static_cast<int> (maxall);
+
+  memory->destroy(parent);
+  memory->destroy(molcount);
+  memory->destroy(molcount_all);
+  memory->destroy(csize);
+  memory->destroy(catoms);
+  memory->destroy(edges);
+  memory->destroy(edges_all);
+  memory->create(parent,nmol+1,"cluster/chain:parent");
+  memory->create(molcount,nmol+1,"cluster/chain:molcount");
+  memory->create(molcount_all,nmol+1,"cluster/chain:molcount_all");
+  memory->create(csize,nmol+1,"cluster/chain:csize");
+  memory->create(catoms,nmol+1,"cluster/chain:catoms");
+  memory->create(edges,2*(nmol+1),"cluster/chain:edges");
+  memory->create(edges_all,2*(nmol+1)*comm->nprocs,"cluster/chain:edges_all");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeClusterChain::init()
+{
+  if (force->pair == NULL || force->pair_match("ljlambda",0) == NULL)
+    error->all(FLERR,"Compute cluster/chain requires pair style ljlambda");
+
+  // pairs closer than the shortest type cutoff are always in the list
+
+  if (cutsq > (neighbor->cutneighmin - neighbor->skin) *
+      (neighbor->cutneighmin - neighbor->skin))
+    error->all(FLERR,"Compute cluster/chain cutoff is longer than "
+               "the pairwise cutoff");
+
+  // the array has one row per chain of the definition, chains added
+  // since (create_atoms, read_data add, fix deposit) have no slot
+
+  if (max_molecule() > nmol)
+    error->all(FLERR,"Compute cluster/chain molecule ID is larger than "
+               "when the compute was defined");
+
+  lastcompute = -1;
+}
+
+/* ----------------------------------------------------------------------
+   union-find over molecule IDs, once per timestep for all outputs
+------------------------------------------------------------------------- */
+
+void ComputeClusterChain::clusters()
+{
+  if (lastcompute == update->ntimestep) return;
+  lastcompute = update->ntimestep;
+
+  double **x = atom->x;
+  int *mask = atom->mask;
+  tagint *molecule = atom->molecule;
+  int nlocal = atom->nlocal;
+
+  NeighList *list = force->pair->list;
+  int inum = list->inum;
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+
+  for (int m = 0; m <= nmol; m++) {
+    parent[m] = m;
+    molcount[m] = 0;
+  }
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || molecule[i] == 0) continue;
+    if (molecule[i] > nmol)
+      error->one(FLERR,"Compute cluster/chain molecule ID is larger than "
+                 "when the compute was defined");
+    molcount[molecule[i]]++;
+  }
+
+  // inter-chain contacts of my atoms, including ghost partners
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+  for (int ii = 0; ii < inum; ii++) {
+    int i = ilist[ii];
+    if (!(mask[i] & groupbit)) continue;
+    int mi = molecule[i];
+    if (mi == 0 || mi > nmol) continue;
+    double xtmp = x[i][0];
+    double ytmp = x[i][1];
+    double ztmp = x[i][2];
+    int *jlist = firstneigh[i];
+    int jnum = numneigh[i];
+
+    for (int jj = 0; jj < jnum; jj++) {
+      int j = jlist[jj] & NEIGHMASK;
+      if (!(mask[j] & groupbit)) continue;
+      int mj = molecule[j];
+      if (mj == mi || mj == 0 || mj > nmol) continue;
+      double delx = xtmp - x[j][0];
+      double dely = ytmp - x[j][1];
+      double delz = ztmp - x[j][2];
+      if (delx*delx + dely*dely + delz*delz < cutsq) uf_union(parent,mi,mj);
+    }
+  }
+
+  // single merge: every rank contributes its (molecule, root) links
+
+  int nedge = 0;
+  for (int m = 1; m <= nmol; m++) {
+    int root = uf_find(parent,m);
+    if (root != m) {
+      edges[2*nedge] = m;
+      edges[2*nedge+1] = root;
+      nedge++;
+    }
+  }
+
+  int nprocs = comm->nprocs;
+  int nsend = 2*nedge;
+  MPI_Allgather(&nsend,1,MPI_INT,recvcounts,1,MPI_INT,world);
+  displs[0] = 0;
+  for (int p = 1; p < nprocs; p++) displs[p] = displs[p-1] + recvcounts[p-1];
+  int ntotal = displs[nprocs-1] + recvcounts[nprocs-1];
+  MPI_Allgatherv(edges,nsend,MPI_INT,edges_all,recvcounts,displs,MPI_INT,world);
+  MPI_Allreduce(molcount,molcount_all,nmol+1,MPI_INT,MPI_SUM,world);
+
+  for (int m = 0; m <= nmol; m++) parent[m] = m;
+  for (int n = 0; n < ntotal; n += 2) uf_union(parent,edges_all[n],edges_all[n+1]);
+
+  // sizes of all clusters, identical on every rank
+
+  for (int m = 0; m <= nmol; m++) csize[m] = catoms[m] = 0;
+  for (int m = 1; m <= nmol; m++) {
+    if (molcount_all[m] == 0) continue;
+    int root = uf_find(parent,m);
+    csize[root]++;
+    catoms[root] += molcount_all[m];
+  }
+
+  largest = 0;
+  for (int m = 1; m <= nmol; m++)
+    if (csize[m] > csize[largest] ||
+        (csize[m] == csize[largest] && catoms[m] > catoms[largest]))
+      largest = m;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeClusterChain::compute_vector()
+{
+  invoked_vector = update->ntimestep;
+  clusters();
+
+  int ncluster = 0;
+  for (int m = 1; m <= nmol; m++)
+    if (csize[m]) ncluster++;
+
+  vector[0] = ncluster;
+  vector[1] = csize[largest];
+  vector[2] = catoms[largest];
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeClusterChain::compute_array()
+{
+  invoked_array = update->ntimestep;
+  clusters();
+
+  for (int s = 0; s < nmol; s++) {
+    array[s][0] = s+1;
+    array[s][1] = 0.0;
+  }
+  for (int m = 1; m <= nmol; m++)
+    if (csize[m]) array[csize[m]-1][1] += 1.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeClusterChain::compute_peratom()
+{
+  invoked_peratom = update->ntimestep;
+  clusters();
+
+  if (atom->nmax > nmax) {
+    memory->destroy(vector_atom);
+    nmax = atom->nmax;
+    memory->create(vector_atom,nmax,"cluster/chain:vector_atom");
+  }
+
+  int *mask = atom->mask;
+  tagint *molecule = atom->molecule;
+  int nlocal = atom->nlocal;
+
+  for (int i = 0; i < nlocal; i++) {
+    vector_atom[i] = 0.0;
+    if ((mask[i] & groupbit) && largest && molecule[i] &&
+        uf_find(parent,molecule[i]) == largest) vector_atom[i] = 1.0;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+double ComputeClusterChain::memory_usage()
+{
+  double bytes = 7.0 * (nmol+1) * sizeof(int);
+  bytes += 2.0 * (nmol+1) * comm->nprocs * sizeof(int);
+  bytes += 2.0 * nmol * sizeof(double);
+  bytes += nmax * sizeof(double);
+  return bytes;
+}
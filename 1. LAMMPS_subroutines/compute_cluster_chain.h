@@ -0,0 +1,91 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Chain-level clusters (condensate detection) from inter-chain contacts
+   in the ljlambda neighbor list: threaded union-find over molecule IDs
+   and one Allgatherv to merge the forests of all ranks
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(cluster/chain,ComputeClusterChain)
+
+#else
+
+#ifndef LMP_COMPUTE_CLUSTER_CHAIN_H
+#define LMP_COMPUTE_CLUSTER_CHAIN_H
+
+#include "compute.h"
+
+namespace LAMMPS_NS {
+
+class ComputeClusterChain : public Compute {
+ public:
+  ComputeClusterChain(class LAMMPS *, int, char **);
+  ~ComputeClusterChain();
+  void init();
+  void compute_vector();
+  void compute_array();
+  void compute_peratom();
+  double memory_usage();
+
+ protected:
+  double cutsq;
+  int nmol;                    // largest molecule ID
+  int *parent;                 // union-find forest over molecule IDs
+  int *molcount,*molcount_all; // atoms of each molecule in group
+  int *csize,*catoms;          // chains / atoms per cluster root
+  int *edges,*edges_all;
+  int *recvcounts,*displs;
+  int nmax;
+  bigint lastcompute;
+  int largest;                 // root of the largest cluster
+
+  void clusters();
+  void setup_molecules();
+  tagint max_molecule();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Compute cluster/chain requires molecule IDs
+
+Chains are identified by their molecule ID.
+
+E: Compute cluster/chain requires pair style ljlambda
+
+The contacts are taken from the neighbor list of the pair style.
+
+E: Compute cluster/chain cutoff is longer than the pairwise cutoff
+
+Pairs within the contact cutoff might be missing from the neighbor list.
+
+E: Too many molecules for compute cluster/chain
+
+Self-explanatory.
+
+E: Compute cluster/chain molecule ID is larger than when the compute was defined
+
+Molecules were added after the compute was defined, e.g. by create_atoms,
+read_data add or fix deposit.  Define the compute after adding them.
+
+*/
@@ -0,0 +1,475 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "compute_widom_chain.h"
+#include "pair_ljlambda.h"
+#include "atom.h"
+#include "update.h"
+#include "domain.h"
+#include "region.h"
+#include "force.h"
+#include "comm.h"
+#include "random_park.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+
+#define MAXLINE 256
+#define MAXTRY 10000
+#define BIG 1.0e20
+
+/* ----------------------------------------------------------------------
+   compute ID group widom/chain file ninsert temp seed keyword value ...
+     batch N = insertions evaluated between two reductions
+     region ID = insertion centers inside region ID only
+   the test chain interacts with the atoms of the group
+   vector = <exp(-dU/kT)>, -kT ln of it, lowest dU of the frame
+------------------------------------------------------------------------- */
+
+ComputeWidomChain::ComputeWidomChain(LAMMPS *lmp, int narg, char **arg) :
+  Compute(lmp, narg, arg),
+  random(NULL), pair(NULL), region(NULL), idregion(NULL),
+  rtype(NULL), rq(NULL), rx(NULL), iconf(NULL), rot(NULL), center(NULL),
+  de(NULL), de_all(NULL), binhead(NULL), bincount(NULL),
+  xs(NULL), ys(NULL), zs(NULL), qs(NULL), ts(NULL)
+{
+  if (narg < 7) error->all(FLERR,"Illegal compute widom/chain command");
+
+  ninsert = utils::inumeric(FLERR,arg[4],false,lmp);
+  temperature = utils::numeric(FLERR,arg[5],false,lmp);
+  int seed = utils::inumeric(FLERR,arg[6],false,lmp);
+  if (ninsert < 1 || temperature <= 0.0 || seed <= 0)
+    error->all(FLERR,"Illegal compute widom/chain command");
+
+  nbatch = 1000;
+
+  int iarg = 7;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"batch") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal compute widom/chain command");
+      nbatch = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      if (nbatch < 1) error->all(FLERR,"Illegal compute widom/chain command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"region") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal compute widom/chain command");
+      delete [] idregion;
+      int n = strlen(arg[iarg+1]) + 1;
+      idregion = new char[n];
+      strcpy(idregion,arg[iarg+1]);
+      iarg += 2;
+    } else error->all(FLERR,"Illegal compute widom/chain command");
+  }
+  nbatch = MIN(nbatch,ninsert);
+
+  read_reservoir(arg[3]);
+
+  // same seed on every rank: all ranks draw the same insertions
+
+  random = new RanPark(lmp,seed);
+
+  vector_flag = 1;
+  size_vector = 3;
+  extvector = 0;
+  vector = new double[size_vector];
+
+  memory->create(iconf,nbatch,"widom/chain:iconf");
+  memory->create(rot,nbatch,9,"widom/chain:rot");
+  memory->create(center,nbatch,3,"widom/chain:center");
+  memory->create(de,nbatch,"widom/chain:de");
+  memory->create(de_all,nbatch,"widom/chain:de_all");
+
+  nsort = maxsort = maxbin = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+ComputeWidomChain::~ComputeWidomChain()
+{
+  delete [] vector;
+  delete [] idregion;
+  delete random;
+  memory->destroy(rtype);
+  memory->destroy(rq);
+  memory->destroy(rx);
+  memory->destroy(iconf);
+  memory->destroy(rot);
+  memory->destroy(center);
+  memory->destroy(de);
+  memory->destroy(de_all);
+  memory->destroy(binhead);
+  memory->destroy(bincount);
+  memory->destroy(xs);
+  memory->destroy(ys);
+  memory->destroy(zs);
+  memory->destroy(qs);
+  memory->destroy(ts);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeWidomChain::init()
+{
+  pair = dynamic_cast<PairLJLambda *>(force->pair_match("ljlambda",0));
+  if (pair == NULL)
+    error->all(FLERR,"Compute widom/chain requires pair style ljlambda");
+
+  if (domain->triclinic || !domain->xperiodic ||
+      !domain->yperiodic || !domain->zperiodic)
+    error->all(FLERR,"Compute widom/chain requires an orthogonal periodic box");
+
+  for (int b = 0; b < nres; b++)
+    if (rtype[b] < 1 || rtype[b] > atom->ntypes)
+      error->all(FLERR,"Reservoir atom type is out of range");
+
+  region = NULL;
+  if (idregion) {
+    int iregion = domain->find_region(idregion);
+    if (iregion == -1)
+      error->all(FLERR,"Region ID for compute widom/chain does not exist");
+    region = domain->regions[iregion];
+  }
+
+  beta = 1.0/(force->boltz*temperature);
+}
+
+/* ----------------------------------------------------------------------
+   reservoir file, '#' starts a comment:
+     nres nconf
+     nres lines:  type charge
+     nconf blocks of nres lines:  x y z
+   every conformation is shifted to its geometric center
+------------------------------------------------------------------------- */
+
+static char *next_line(FILE *fp, char *line)
+{
+  while (fgets(line,MAXLINE,fp)) {
+    char *ptr = strchr(line,'#');
+    if (ptr) *ptr = '\0';
+    if (strspn(line," \t\n\r") != strlen(line)) return line;
+  }
+  return NULL;
+}
+
+void ComputeWidomChain::read_reservoir(const char *file)
+{
+  int header[2] = {0,0};
+  int flag = 0;
+  FILE *fp = NULL;
+  char line[MAXLINE];
+
+  if (comm->me == 0) {
+    fp = fopen(file,"r");
+    if (fp == NULL) {
+      char str[128];
+      snprintf(str,128,"Cannot open reservoir file %s",file);
+      error->one(FLERR,str);
+    }
+    if (!next_line(fp,line) ||
+        sscanf(line,"%d %d",&header[0],&header[1]) != 2 ||
+        header[0] < 1 || header[1] < 1) flag = 1;
+  }
+  MPI_Bcast(&flag,1,MPI_INT,0,world);
+  if (flag) error->all(FLERR,"Invalid reservoir file");
+  MPI_Bcast(header,2,MPI_INT,0,world);
+  nres = header[0];
+  nconf = header[1];
+
+  memory->create(rtype,nres,"widom/chain:rtype");
+  memory->create(rq,nres,"widom/chain:rq");
+  memory->create(rx,nconf,nres,3,"widom/chain:rx");
+
+  if (comm->me == 0) {
+    for (int b = 0; b < nres && !flag; b++)
+      if (!next_line(fp,line) || sscanf(line,"%d %lg",&rtype[b],&rq[b]) != 2)
+        flag = 1;
+    for (int c = 0; c < nconf && !flag; c++) {
+      double cm[3] = {0.0,0.0,0.0};
+      for (int b = 0; b < nres && !flag; b++) {
+        if (!next_line(fp,line) ||
+            sscanf(line,"%lg %lg %lg",&rx[c][b][0],&rx[c][b][1],&rx[c][b][2]) != 3)
+          flag = 1;
+        else for (int d = 0; d < 3; d++) cm[d] += rx[c][b][d];
+      }
+      for (int b = 0; b < nres; b++)
+        for (int d = 0; d < 3; d++) rx[c][b][d] -= cm[d]/nres;
+    }
+    fclose(fp);
+  }
+  MPI_Bcast(&flag,1,MPI_INT,0,world);
+  if (flag) error->all(FLERR,"Invalid reservoir file");
+
+  MPI_Bcast(rtype,nres,MPI_INT,0,world);
+  MPI_Bcast(rq,nres,MPI_DOUBLE,0,world);
+  MPI_Bcast(&rx[0][0][0],3*nres*nconf,MPI_DOUBLE,0,world);
+}
+
+/* ----------------------------------------------------------------------
+   counting sort of the owned atoms of the group onto a periodic grid of
+   cells no smaller than the largest pair cutoff
+   a dimension with fewer than 3 cells is a single cell searched alone
+------------------------------------------------------------------------- */
+
+void ComputeWidomChain::bin_atoms()
+{
+  double cut = force->pair->cutforce;
+  int nbins = 1;
+  for (int d = 0; d < 3; d++) {
+    nbin[d] = static_cast<int> (domain->prd[d]/cut);
+    if (nbin[d] < 3) {
+      nbin[d] = 1;
+      nstencil[d] = 0;
+    } else nstencil[d] = 1;
+    binsize[d] = domain->prd[d]/nbin[d];
+    bininv[d] = 1.0/binsize[d];
+    nbins *= nbin[d];
+  }
+
+  if (nbins > maxbin) {
+    maxbin = nbins;
+    memory->destroy(binhead);
+    memory->destroy(bincount);
+    memory->create(binhead,maxbin,"widom/chain:binhead");
+    memory->create(bincount,maxbin,"widom/chain:bincount");
+  }
+
+  double **x = atom->x;
+  double *q = atom->q;
+  int *type = atom->type;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+
+  if (nlocal > maxsort) {
+    maxsort = atom->nmax;
+    memory->destroy(xs);
+    memory->destroy(ys);
+    memory->destroy(zs);
+    memory->destroy(qs);
+    memory->destroy(ts);
+    memory->create(xs,maxsort,"widom/chain:xs");
+    memory->create(ys,maxsort,"widom/chain:ys");
+    memory->create(zs,maxsort,"widom/chain:zs");
+    memory->create(qs,maxsort,"widom/chain:qs");
+    memory->create(ts,maxsort,"widom/chain:ts");
+  }
+
+  for (int m = 0; m < nbins; m++) bincount[m] = 0;
+
+  // two passes: count per cell, then place at the running cell offset
+
+  int *ibin = new int[nlocal];
+  for (int i = 0; i < nlocal; i++) {
+    ibin[i] = -1;
+    if (!(mask[i] & groupbit)) continue;
+    int c[3];
+    for (int d = 0; d < 3; d++) {
+      c[d] = static_cast<int> (floor((x[i][d]-domain->boxlo[d])*bininv[d]));
+      c[d] %= nbin[d];
+      if (c[d] < 0) c[d] += nbin[d];
+    }
+    ibin[i] = (c[2]*nbin[1] + c[1])*nbin[0] + c[0];
+    bincount[ibin[i]]++;
+  }
+
+  nsort = 0;
+  for (int m = 0; m < nbins; m++) {
+    binhead[m] = nsort;
+    nsort += bincount[m];
+    bincount[m] = 0;
+  }
+
+  for (int i = 0; i < nlocal; i++) {
+    if (ibin[i] < 0) continue;
+    int m = binhead[ibin[i]] + bincount[ibin[i]]++;
+    xs[m] = x[i][0];
+    ys[m] = x[i][1];
+    zs[m] = x[i][2];
+    qs[m] = q[i];
+    ts[m] = type[i];
+  }
+  delete [] ibin;
+}
+
+/* ----------------------------------------------------------------------
+   conformation, uniform random rotation (unit quaternion) and center
+------------------------------------------------------------------------- */
+
+void ComputeWidomChain::random_insertion(int k)
+{
+  iconf[k] = static_cast<int> (random->uniform()*nconf);
+  if (iconf[k] >= nconf) iconf[k] = nconf-1;
+
+  double u1 = random->uniform();
+  double u2 = MY_2PI*random->uniform();
+  double u3 = MY_2PI*random->uniform();
+  double a = sqrt(1.0-u1);
+  double b = sqrt(u1);
+  double q0 = b*cos(u3);
+  double q1 = a*sin(u2);
+  double q2 = a*cos(u2);
+  double q3 = b*sin(u3);
+
+  double *r = rot[k];
+  r[0] = q0*q0 + q1*q1 - q2*q2 - q3*q3;
+  r[1] = 2.0*(q1*q2 - q0*q3);
+  r[2] = 2.0*(q1*q3 + q0*q2);
+  r[3] = 2.0*(q1*q2 + q0*q3);
+  r[4] = q0*q0 - q1*q1 + q2*q2 - q3*q3;
+  r[5] = 2.0*(q2*q3 - q0*q1);
+  r[6] = 2.0*(q1*q3 - q0*q2);
+  r[7] = 2.0*(q2*q3 + q0*q1);
+  r[8] = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+
+  double lo[3],hi[3];
+  for (int d = 0; d < 3; d++) {
+    lo[d] = domain->boxlo[d];
+    hi[d] = domain->boxhi[d];
+  }
+  if (region && region->bboxflag) {
+    lo[0] = MAX(lo[0],region->extent_xlo);
+    hi[0] = MIN(hi[0],region->extent_xhi);
+    lo[1] = MAX(lo[1],region->extent_ylo);
+    hi[1] = MIN(hi[1],region->extent_yhi);
+    lo[2] = MAX(lo[2],region->extent_zlo);
+    hi[2] = MIN(hi[2],region->extent_zhi);
+  }
+
+  double *c = center[k];
+  for (int ntry = 0; ntry < MAXTRY; ntry++) {
+    for (int d = 0; d < 3; d++) c[d] = lo[d] + random->uniform()*(hi[d]-lo[d]);
+    if (!region || region->match(c[0],c[1],c[2])) return;
+  }
+  error->all(FLERR,"Compute widom/chain could not place a chain in region");
+}
+
+/* ----------------------------------------------------------------------
+   energy of insertion k with the owned atoms of this rank
+   the cell loops are unit-stride over the sorted arrays
+------------------------------------------------------------------------- */
+
+double ComputeWidomChain::insertion_energy(int k)
+{
+  const double * const r = rot[k];
+  const double * const c = center[k];
+  double **xc = rx[iconf[k]];
+  const PairLJLambda * const lj = pair;
+  const double qqrd2e = force->qqrd2e;
+  const double * const boxlo = domain->boxlo;
+  const double * const prd = domain->prd;
+  const double xprdinv = 1.0/prd[0];
+  const double yprdinv = 1.0/prd[1];
+  const double zprdinv = 1.0/prd[2];
+
+  double energy = 0.0;
+
+  for (int b = 0; b < nres; b++) {
+    double xb[3];
+    for (int d = 0; d < 3; d++)
+      xb[d] = c[d] + r[3*d]*xc[b][0] + r[3*d+1]*xc[b][1] + r[3*d+2]*xc[b][2];
+
+    int cb[3];
+    for (int d = 0; d < 3; d++)
+      cb[d] = static_cast<int> (floor((xb[d]-boxlo[d])*bininv[d]));
+
+    const int itype = rtype[b];
+    const double prefactor = qqrd2e*rq[b];
+
+    for (int iz = -nstencil[2]; iz <= nstencil[2]; iz++)
+      for (int iy = -nstencil[1]; iy <= nstencil[1]; iy++)
+        for (int ix = -nstencil[0]; ix <= nstencil[0]; ix++) {
+          int jx = (cb[0]+ix) % nbin[0];
+          int jy = (cb[1]+iy) % nbin[1];
+          int jz = (cb[2]+iz) % nbin[2];
+          if (jx < 0) jx += nbin[0];
+          if (jy < 0) jy += nbin[1];
+          if (jz < 0) jz += nbin[2];
+          int m = (jz*nbin[1] + jy)*nbin[0] + jx;
+          const int first = binhead[m];
+          const int last = first + bincount[m];
+
+          double esum = 0.0;
+#if defined(_OPENMP)
+#pragma omp simd reduction(+:esum)
+#endif
+          for (int j = first; j < last; j++) {
+            double delx = xb[0] - xs[j];
+            double dely = xb[1] - ys[j];
+            double delz = xb[2] - zs[j];
+            delx -= prd[0]*rint(delx*xprdinv);
+            dely -= prd[1]*rint(dely*yprdinv);
+            delz -= prd[2]*rint(delz*zprdinv);
+            double rsq = delx*delx + dely*dely + delz*delz;
+            esum += lj->single_energy(itype,ts[j],prefactor*qs[j],rsq);
+          }
+          energy += esum;
+        }
+  }
+
+  return energy;
+}
+
+/* ----------------------------------------------------------------------
+   insertions are drawn serially (same on all ranks), evaluated by threads
+   and summed over ranks once per batch
+------------------------------------------------------------------------- */
+
+void ComputeWidomChain::compute_vector()
+{
+  invoked_vector = update->ntimestep;
+
+  bin_atoms();
+  if (region) region->prematch();
+
+  double boltzsum = 0.0;
+  double demin = BIG;
+
+  for (int start = 0; start < ninsert; start += nbatch) {
+    int n = MIN(nbatch,ninsert-start);
+    for (int k = 0; k < n; k++) random_insertion(k);
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,4)
+#endif
+    for (int k = 0; k < n; k++) de[k] = insertion_energy(k);
+
+    MPI_Allreduce(de,de_all,n,MPI_DOUBLE,MPI_SUM,world);
+
+    for (int k = 0; k < n; k++) {
+      boltzsum += exp(-beta*de_all[k]);
+      demin = MIN(demin,de_all[k]);
+    }
+  }
+
+  vector[0] = boltzsum/ninsert;
+  vector[1] = (boltzsum > 0.0) ? -log(vector[0])/beta : BIG;
+  vector[2] = demin;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double ComputeWidomChain::memory_usage()
+{
+  double bytes = nres * (sizeof(int) + sizeof(double));
+  bytes += 3.0 * nconf*nres * sizeof(double);
+  bytes += nbatch * (sizeof(int) + 14.0*sizeof(double));
+  bytes += 2.0 * maxbin * sizeof(int);
+  bytes += maxsort * (4.0*sizeof(double) + sizeof(int));
+  return bytes;
+}
@@ -0,0 +1,117 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Widom test-chain insertion: rigid conformations from a reservoir file
+   inserted at random positions/orientations, energies from the ljlambda
+   pair coefficients on a cell list of the owned atoms
+------------------------------------------------------------------------- */
+
+#ifdef COMPUTE_CLASS
+
+ComputeStyle(widom/chain,ComputeWidomChain)
+
+#else
+
+#ifndef LMP_COMPUTE_WIDOM_CHAIN_H
+#define LMP_COMPUTE_WIDOM_CHAIN_H
+
+#include "compute.h"
+
+namespace LAMMPS_NS {
+
+class ComputeWidomChain : public Compute {
+ public:
+  ComputeWidomChain(class LAMMPS *, int, char **);
+  ~ComputeWidomChain();
+  void init();
+  void compute_vector();
+  double memory_usage();
+
+ protected:
+  int ninsert,nbatch;
+  double temperature,beta;
+  class RanPark *random;
+  class PairLJLambda *pair;
+  class Region *region;
+  char *idregion;
+
+  // reservoir: nconf conformations of nres beads, centered at the origin
+
+  int nres,nconf;
+  int *rtype;
+  double *rq;
+  double ***rx;
+
+  // insertions of one batch: conformation, rotation, center
+
+  int *iconf;
+  double **rot,**center;
+  double *de,*de_all;
+
+  // owned atoms of the group sorted by cell (structure of arrays)
+
+  int nbin[3],nstencil[3];
+  double binsize[3],bininv[3];
+  int *binhead,*bincount;
+  double *xs,*ys,*zs,*qs;
+  int *ts;
+  int nsort,maxsort,maxbin;
+
+  void read_reservoir(const char *);
+  void bin_atoms();
+  void random_insertion(int);
+  double insertion_energy(int);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Cannot open reservoir file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Invalid reservoir file
+
+The file must hold "nres nconf", nres lines "type charge" and nconf
+blocks of nres lines "x y z".
+
+E: Region ID for compute widom/chain does not exist
+
+Self-explanatory.
+
+E: Compute widom/chain requires pair style ljlambda
+
+The insertion energies use the ljlambda coefficients.
+
+E: Compute widom/chain requires an orthogonal periodic box
+
+Minimum image distances are taken on an orthogonal box.
+
+E: Reservoir atom type is out of range
+
+Self-explanatory.
+
+E: Compute widom/chain could not place a chain in region
+
+No random point of the region bounding box was inside the region.
+
+*/
@@ -18,7 +18,9 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include "dihedral_gaussian.h"
+#include "compute_bonded_hist.h"
 #include "atom.h"
 #include "neighbor.h"
 #include "domain.h"
@@ -30,6 +32,8 @@
 #include "memory.h"
 #include "error.h"
 #include "utils.h"
+#include "fixed_point.h"
+#include "rigid_body.h"
 
 using namespace LAMMPS_NS;
 using namespace MathConst;
@@ -40,7 +44,35 @@ using namespace MathConst;
 
 /* ---------------------------------------------------------------------- */
 
-DihedralGaussian::DihedralGaussian(LAMMPS *lmp) : Dihedral(lmp) {}
+DihedralGaussian::DihedralGaussian(LAMMPS *lmp) : Dihedral(lmp)
+{
+  ka = 11.4;
+  kb = 0.15;
+  kc = 1.8;
+  kd = 0.65;
+
+  fa = 0.9;
+  fb = 1.02;
+  fc = -1.55;
+  fd = -2.5;
+
+  eb0 = 0.27;
+  ec0 = 0.14;
+  ed0 = 0.26;
+
+  num_tally_compute = 0;
+  list_tally_compute = NULL;
+
+  timeflag = 0;
+  time_compute = 0.0;
+
+  fixedflag = 0;
+  ffix = NULL;
+  nmax_fix = 0;
+
+  idbody = NULL;
+  ibody = -1;
+}
 
 /* ---------------------------------------------------------------------- */
 
@@ -50,6 +82,9 @@ DihedralGaussian::~DihedralGaussian()
     memory->destroy(setflag);
     memory->destroy(epsdihed);
   }
+  memory->sfree(list_tally_compute);
+  memory->destroy(ffix);
+  delete [] idbody;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -68,6 +103,9 @@ void DihedralGaussian::compute(int eflag, int vflag)
   double pa,pb,pb2,pc,pc2,pd,pd2,ea,eb,eb2,ec,ec2,ed,ed2;
   double fea,feb,feb2,fec,fec2,fed,fed2;
 
+  double time_start = 0.0;
+  if (timeflag) time_start = MPI_Wtime();
+
   edihedral = 0.0;
   ev_init(eflag,vflag);
 
@@ -76,21 +114,24 @@ void DihedralGaussian::compute(int eflag, int vflag)
   int **dihedrallist = neighbor->dihedrallist;
   int ndihedrallist = neighbor->ndihedrallist;
   int nlocal = atom->nlocal;
+  int nall = nlocal + atom->nghost;
   int newton_bond = force->newton_bond;
 
-  double ka = 11.4;
-  double kb = 0.15;
-  double kc = 1.8;
-  double kd = 0.65;
+  // deterministic mode: sum forces as fixed-point integers, add to f at end
 
-  double fa = 0.9;
-  double fb = 1.02;
-  double fc = -1.55;
-  double fd = -2.5;
+  bigint **ff = NULL;
+  int oflow = 0;
+  if (fixedflag) {
+    FixedPoint::setup(memory,ffix,nmax_fix,atom->nmax,nall,"dihedral:ffix");
+    ff = ffix;
+  }
+
+  for (int k = 0; k < num_tally_compute; k++)
+    list_tally_compute[k]->bonded_setup_callback();
 
-  double eb0 = 0.27;
-  double ec0 = 0.14;
-  double ed0 = 0.26;
+  // dihedrals with all atoms in the same rigid body are skipped
+
+  int *body = idbody ? atom->ivector[ibody] : NULL;
 
   for (n = 0; n < ndihedrallist; n++) {
     i1 = dihedrallist[n][0];
@@ -99,6 +140,9 @@ void DihedralGaussian::compute(int eflag, int vflag)
     i4 = dihedrallist[n][3];
     type = dihedrallist[n][4];
 
+    if (body && body[i2] && body[i1] == body[i2] && body[i3] == body[i2] &&
+        body[i4] == body[i2]) continue;
+
     // 1st bond
 
     vb1x = x[i1][0] - x[i2][0];
@@ -205,6 +249,11 @@ void DihedralGaussian::compute(int eflag, int vflag)
 
     phi = acos(c);
     if (dx > 0.0) phi *= -1.0;
+
+    for (int k = 0; k < num_tally_compute; k++)
+      list_tally_compute[k]->dihedral_tally_callback(i1,i2,i3,i4,nlocal,
+                                                     newton_bond,phi);
+
     si = sin(phi);
     if (fabs(si) < SMALLER) si = SMALLER;
     siinv = 1.0/si;
@@ -282,28 +331,39 @@ void DihedralGaussian::compute(int eflag, int vflag)
 
     // apply force to each of 4 atoms
 
-    if (newton_bond || i1 < nlocal) {
-      f[i1][0] += f1[0];
-      f[i1][1] += f1[1];
-      f[i1][2] += f1[2];
-    }
+    if (fixedflag) {
+      if (newton_bond || i1 < nlocal)
+        FixedPoint::add(ff[i1],f1[0],f1[1],f1[2],oflow);
+      if (newton_bond || i2 < nlocal)
+        FixedPoint::add(ff[i2],f2[0],f2[1],f2[2],oflow);
+      if (newton_bond || i3 < nlocal)
+        FixedPoint::add(ff[i3],f3[0],f3[1],f3[2],oflow);
+      if (newton_bond || i4 < nlocal)
+        FixedPoint::add(ff[i4],f4[0],f4[1],f4[2],oflow);
+    } else {
+      if (newton_bond || i1 < nlocal) {
+        f[i1][0] += f1[0];
+        f[i1][1] += f1[1];
+        f[i1][2] += f1[2];
+      }
 
-    if (newton_bond || i2 < nlocal) {
-      f[i2][0] += f2[0];
-      f[i2][1] += f2[1];
-      f[i2][2] += f2[2];
-    }
+      if (newton_bond || i2 < nlocal) {
+        f[i2][0] += f2[0];
+        f[i2][1] += f2[1];
+        f[i2][2] += f2[2];
+      }
 
-    if (newton_bond || i3 < nlocal) {
-      f[i3][0] += f3[0];
-      f[i3][1] += f3[1];
-      f[i3][2] += f3[2];
-    }
+      if (newton_bond || i3 < nlocal) {
+        f[i3][0] += f3[0];
+        f[i3][1] += f3[1];
+        f[i3][2] += f3[2];
+      }
 
-    if (newton_bond || i4 < nlocal) {
-      f[i4][0] += f4[0];
-      f[i4][1] += f4[1];
-      f[i4][2] += f4[2];
+      if (newton_bond || i4 < nlocal) {
+        f[i4][0] += f4[0];
+        f[i4][1] += f4[1];
+        f[i4][2] += f4[2];
+      }
     }
 
     if (evflag)
@@ -311,6 +371,44 @@ void DihedralGaussian::compute(int eflag, int vflag)
                vb1x,vb1y,vb1z,vb2x,vb2y,vb2z,vb3x,vb3y,vb3z);
 
   }
+
+  if (fixedflag) {
+    if (oflow) error->one(FLERR,"Force too large for fixed-point summation");
+    FixedPoint::flush(f,ffix,nall);
+  }
+
+  if (timeflag) time_compute += MPI_Wtime() - time_start;
+}
+
+/* ----------------------------------------------------------------------
+   register a compute that is fed phi of every dihedral from compute()
+------------------------------------------------------------------------- */
+
+void DihedralGaussian::add_tally_callback(ComputeBondedHist *ptr)
+{
+  for (int i = 0; i < num_tally_compute; i++)
+    if (list_tally_compute[i] == ptr) return;
+
+  num_tally_compute++;
+  list_tally_compute = (ComputeBondedHist **)
+    memory->srealloc(list_tally_compute,
+                     num_tally_compute*sizeof(ComputeBondedHist *),
+                     "dihedral:list_tally_compute");
+  list_tally_compute[num_tally_compute-1] = ptr;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DihedralGaussian::del_tally_callback(ComputeBondedHist *ptr)
+{
+  int found = -1;
+  for (int i = 0; i < num_tally_compute; i++)
+    if (list_tally_compute[i] == ptr) found = i;
+  if (found < 0) return;
+
+  num_tally_compute--;
+  for (int i = found; i < num_tally_compute; i++)
+    list_tally_compute[i] = list_tally_compute[i+1];
 }
 
 /* ---------------------------------------------------------------------- */
@@ -326,6 +424,52 @@ void DihedralGaussian::allocate()
   for (int i = 1; i <= n; i++) setflag[i] = 0;
 }
 
+/* ----------------------------------------------------------------------
+   global settings, optional keyword/value pairs for the shape constants
+   e.g. as written by FitBondedParam, and fixed yes/no for deterministic
+   fixed-point force summation, rigid i_name to skip terms inside a body
+------------------------------------------------------------------------- */
+
+void DihedralGaussian::settings(int narg, char **arg)
+{
+  if (narg % 2) error->all(FLERR,"Illegal dihedral_style command");
+
+  fixedflag = 0;
+  delete [] idbody;
+  idbody = NULL;
+
+  for (int iarg = 0; iarg < narg; iarg += 2) {
+    if (strcmp(arg[iarg],"fixed") == 0) {
+      if (strcmp(arg[iarg+1],"yes") == 0) fixedflag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) fixedflag = 0;
+      else error->all(FLERR,"Illegal dihedral_style command");
+      continue;
+    }
+    if (strcmp(arg[iarg],"rigid") == 0) {
+      if (strncmp(arg[iarg+1],"i_",2) != 0)
+        error->all(FLERR,"Illegal dihedral_style command");
+      delete [] idbody;
+      idbody = new char[strlen(arg[iarg+1])-1];
+      strcpy(idbody,&arg[iarg+1][2]);
+      continue;
+    }
+
+    double value = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+    if (strcmp(arg[iarg],"ka") == 0) ka = value;
+    else if (strcmp(arg[iarg],"kb") == 0) kb = value;
+    else if (strcmp(arg[iarg],"kc") == 0) kc = value;
+    else if (strcmp(arg[iarg],"kd") == 0) kd = value;
+    else if (strcmp(arg[iarg],"fa") == 0) fa = value;
+    else if (strcmp(arg[iarg],"fb") == 0) fb = value;
+    else if (strcmp(arg[iarg],"fc") == 0) fc = value;
+    else if (strcmp(arg[iarg],"fd") == 0) fd = value;
+    else if (strcmp(arg[iarg],"eb0") == 0) eb0 = value;
+    else if (strcmp(arg[iarg],"ec0") == 0) ec0 = value;
+    else if (strcmp(arg[iarg],"ed0") == 0) ed0 = value;
+    else error->all(FLERR,"Illegal dihedral_style command");
+  }
+}
+
 /* ----------------------------------------------------------------------
    set coeffs for one type
 ------------------------------------------------------------------------- */
@@ -350,12 +494,25 @@ void DihedralGaussian::coeff(int narg, char **arg)
   if (count == 0) error->all(FLERR,"Incorrect args for dihedral coefficients");
 }
 
+/* ----------------------------------------------------------------------
+   timings follow the LAMMPS breakdown, which is reset for every run
+------------------------------------------------------------------------- */
+
+void DihedralGaussian::init_style()
+{
+  time_compute = 0.0;
+
+  if (idbody)
+    ibody = RigidBody::find(atom,modify,error,idbody,"dihedral_style gaussian");
+}
+
 /* ----------------------------------------------------------------------
    proc 0 writes out coeffs to restart file
 ------------------------------------------------------------------------- */
 
 void DihedralGaussian::write_restart(FILE *fp)
 {
+  write_restart_settings(fp);
   fwrite(&epsdihed[1],sizeof(double),atom->ndihedraltypes,fp);
 }
 
@@ -365,6 +522,7 @@ void DihedralGaussian::write_restart(FILE *fp)
 
 void DihedralGaussian::read_restart(FILE *fp)
 {
+  read_restart_settings(fp);
   allocate();
 
   if (comm->me == 0) {
@@ -377,6 +535,46 @@ void DihedralGaussian::read_restart(FILE *fp)
   }
 }
 
+/* ----------------------------------------------------------------------
+   proc 0 writes out shape constants and fixed/rigid settings to restart file
+------------------------------------------------------------------------- */
+
+void DihedralGaussian::write_restart_settings(FILE *fp)
+{
+  double shape[11] = {ka,kb,kc,kd,fa,fb,fc,fd,eb0,ec0,ed0};
+  fwrite(shape,sizeof(double),11,fp);
+  fwrite(&fixedflag,sizeof(int),1,fp);
+  RigidBody::write(fp,idbody);
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 reads shape constants and fixed/rigid settings from restart file, bcasts
+------------------------------------------------------------------------- */
+
+void DihedralGaussian::read_restart_settings(FILE *fp)
+{
+  double shape[11];
+  if (comm->me == 0) {
+    utils::sfread(FLERR,shape,sizeof(double),11,fp,NULL,error);
+    utils::sfread(FLERR,&fixedflag,sizeof(int),1,fp,NULL,error);
+  }
+  MPI_Bcast(shape,11,MPI_DOUBLE,0,world);
+  MPI_Bcast(&fixedflag,1,MPI_INT,0,world);
+  RigidBody::read(fp,idbody,comm->me,world,error);
+
+  ka = shape[0];
+  kb = shape[1];
+  kc = shape[2];
+  kd = shape[3];
+  fa = shape[4];
+  fb = shape[5];
+  fc = shape[6];
+  fd = shape[7];
+  eb0 = shape[8];
+  ec0 = shape[9];
+  ed0 = shape[10];
+}
+
 /* ----------------------------------------------------------------------
    proc 0 writes to data file
 ------------------------------------------------------------------------- */
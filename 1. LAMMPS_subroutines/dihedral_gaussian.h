@@ -37,13 +37,36 @@ class DihedralGaussian : public Dihedral {
   DihedralGaussian(class LAMMPS *);
   ~DihedralGaussian();
   void compute(int, int);
+  void settings(int, char **);
   void coeff(int, char **);
   void write_restart(FILE *);
   void read_restart(FILE *);
+  void write_restart_settings(FILE *);
+  void read_restart_settings(FILE *);
+  void init_style();
   void write_data(FILE *);
 
+  void add_tally_callback(class ComputeBondedHist *);
+  void del_tally_callback(class ComputeBondedHist *);
+
+  int timeflag;                // 1 if compute() is timed
+  double time_compute;         // wall time spent in compute() this run
+
  protected:
   double *epsdihed;
+  double ka,kb,kc,kd;          // widths of the four wells
+  double fa,fb,fc,fd;          // positions of the four wells
+  double eb0,ec0,ed0;          // well offsets
+
+  int num_tally_compute;
+  class ComputeBondedHist **list_tally_compute;
+
+  int fixedflag;               // 1 = deterministic fixed-point forces
+  bigint **ffix;
+  int nmax_fix;
+
+  char *idbody;                // i_name of the rigid body ID, NULL = none
+  int ibody;
 
   void allocate();
 };
@@ -52,3 +75,27 @@ class DihedralGaussian : public Dihedral {
 
 #endif
 #endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal dihedral_style command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
+E: Rigid body property for dihedral_style gaussian does not exist
+
+The rigid keyword needs an integer per-atom property, e.g. defined by
+fix property/atom i_body ghost yes.
+
+E: Rigid body property for dihedral_style gaussian needs fix property/atom ghost yes
+
+Body IDs of ghost atoms are used, so the property must be defined by
+a fix property/atom with ghost yes.
+
+E: Force too large for fixed-point summation
+
+With fixed yes a single force component must stay below 2^20
+kcal/mol/Angstrom (or is NaN).  Minimize first or use fixed no.
+
+*/
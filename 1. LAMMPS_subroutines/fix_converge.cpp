@@ -0,0 +1,471 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "fix_converge.h"
+#include "atom.h"
+#include "domain.h"
+#include "update.h"
+#include "comm.h"
+#include "timer.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+#define NBLOCK_MAX 64
+
+/* ----------------------------------------------------------------------
+   fix ID group converge N nres tol_helix tol_rg keyword value ...
+     every N steps: per-residue helix fraction and Rg, averaged over chains
+     nres = residues per chain, chain c = atom IDs c*nres+1 .. (c+1)*nres
+     tol_helix = target standard error of every residue's helix fraction
+     tol_rg = target standard error of Rg (Angstrom)
+   keywords:
+     dihed lo hi = helical dihedral range in rad (default 0.25 1.7)
+     r14 lo hi = helical (i,i+4) distance window (default 0 100)
+     nn n pattern = helical residues of n consecutive ones (default 3 010)
+     start step = first sampled step (default 0)
+     blocks nmin = blocks needed for a decision (default 16)
+     minlen L = shortest block in samples for a decision (default 10)
+     stop yes/no = stop the run itself once converged (default no)
+   helicity follows the (i,i+4) rule of HelixFracDihed15 with -nn
+------------------------------------------------------------------------- */
+
+FixConverge::FixConverge(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg),
+  pattern(NULL), hcon(NULL), hcon_all(NULL), part(NULL), rgsum(NULL),
+  rgsum_all(NULL), sample(NULL), block(NULL), partial(NULL), mean(NULL),
+  err(NULL)
+{
+  if (narg < 7) error->all(FLERR,"Illegal fix converge command");
+
+  nevery = utils::inumeric(FLERR,arg[3],false,lmp);
+  nres = utils::inumeric(FLERR,arg[4],false,lmp);
+  tol_helix = utils::numeric(FLERR,arg[5],false,lmp);
+  tol_rg = utils::numeric(FLERR,arg[6],false,lmp);
+  if (nevery <= 0 || nres < 5 || tol_helix <= 0.0 || tol_rg <= 0.0)
+    error->all(FLERR,"Illegal fix converge command");
+
+  dlo = 0.25;
+  dhi = 1.7;
+  r14lo = 0.0;
+  r14hi = 100.0;
+  nn = 3;
+  nstart = 0;
+  nblock_min = 16;
+  len_min = 10;
+  stopflag = 0;
+  const char *str = "010";
+
+  int iarg = 7;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"dihed") == 0) {
+      if (iarg+3 > narg) error->all(FLERR,"Illegal fix converge command");
+      dlo = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+      dhi = utils::numeric(FLERR,arg[iarg+2],false,lmp);
+      if (dhi <= dlo) error->all(FLERR,"Illegal fix converge command");
+      iarg += 3;
+    } else if (strcmp(arg[iarg],"r14") == 0) {
+      if (iarg+3 > narg) error->all(FLERR,"Illegal fix converge command");
+      r14lo = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+      r14hi = utils::numeric(FLERR,arg[iarg+2],false,lmp);
+      if (r14lo < 0.0 || r14hi <= r14lo)
+        error->all(FLERR,"Illegal fix converge command");
+      iarg += 3;
+    } else if (strcmp(arg[iarg],"nn") == 0) {
+      if (iarg+3 > narg) error->all(FLERR,"Illegal fix converge command");
+      nn = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      if (nn < 1 || nn > nres) error->all(FLERR,"Illegal fix converge command");
+      str = arg[iarg+2];
+      iarg += 3;
+    } else if (strcmp(arg[iarg],"start") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix converge command");
+      nstart = utils::bnumeric(FLERR,arg[iarg+1],false,lmp);
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"blocks") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix converge command");
+      nblock_min = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      if (nblock_min < 2 || nblock_min > NBLOCK_MAX/2)
+        error->all(FLERR,"Illegal fix converge command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"minlen") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix converge command");
+      len_min = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      if (len_min < 1) error->all(FLERR,"Illegal fix converge command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"stop") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix converge command");
+      if (strcmp(arg[iarg+1],"yes") == 0) stopflag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) stopflag = 0;
+      else error->all(FLERR,"Illegal fix converge command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix converge command");
+  }
+
+  if ((int) strlen(str) != nn)
+    error->all(FLERR,"Fix converge pattern length does not match nn");
+  memory->create(pattern,nn,"converge:pattern");
+  for (int j = 0; j < nn; j++) pattern[j] = (str[j] == '1') ? 1 : 0;
+
+  if (atom->tag_enable == 0)
+    error->all(FLERR,"Fix converge requires atom IDs");
+  if (atom->map_style == 0)
+    error->all(FLERR,"Fix converge requires an atom map, see atom_modify");
+  if (atom->natoms > MAXSMALLINT)
+    error->all(FLERR,"Too many atoms for fix converge");
+  if (atom->natoms % nres)
+    error->all(FLERR,"Fix converge chain length does not divide "
+               "the number of atoms");
+  nchain = static_cast<int> (atom->natoms) / nres;
+
+  nobs = nres + 1;
+  int natoms = static_cast<int> (atom->natoms);
+  memory->create(hcon,natoms,"converge:hcon");
+  memory->create(hcon_all,natoms,"converge:hcon_all");
+  memory->create(part,nres,"converge:part");
+  memory->create(rgsum,5*nchain,"converge:rgsum");
+  memory->create(rgsum_all,5*nchain,"converge:rgsum_all");
+  memory->create(sample,nobs,"converge:sample");
+  memory->create(block,NBLOCK_MAX,nobs,"converge:block");
+  memory->create(partial,nobs,"converge:partial");
+  memory->create(mean,nobs,"converge:mean");
+  memory->create(err,nobs,"converge:err");
+
+  for (int k = 0; k < nobs; k++) partial[k] = mean[k] = err[k] = 0.0;
+  nblock = npartial = 0;
+  blocklen = 1;
+  nsample = 0;
+  convflag = 0;
+
+  scalar_flag = 1;
+  vector_flag = 1;
+  size_vector = 6;
+  array_flag = 1;
+  size_array_rows = nres;
+  size_array_cols = 2;
+  global_freq = nevery;
+  extscalar = 0;
+  extvector = 0;
+  extarray = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixConverge::~FixConverge()
+{
+  memory->destroy(pattern);
+  memory->destroy(hcon);
+  memory->destroy(hcon_all);
+  memory->destroy(part);
+  memory->destroy(rgsum);
+  memory->destroy(rgsum_all);
+  memory->destroy(sample);
+  memory->destroy(block);
+  memory->destroy(partial);
+  memory->destroy(mean);
+  memory->destroy(err);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixConverge::setmask()
+{
+  int mask = 0;
+  mask |= END_OF_STEP;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixConverge::init()
+{
+  if (atom->map_style == 0)
+    error->all(FLERR,"Fix converge requires an atom map, see atom_modify");
+  if (atom->natoms != (bigint) nres*nchain)
+    error->all(FLERR,"Fix converge chain length does not divide "
+               "the number of atoms");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixConverge::end_of_step()
+{
+  if (update->ntimestep < nstart) return;
+
+  measure();
+  add_sample();
+  statistics();
+
+  if (convflag) return;
+
+  double maxerr = 0.0;
+  for (int p = 0; p < nres; p++) maxerr = MAX(maxerr,err[p]);
+
+  if (nblock < nblock_min || blocklen < len_min) return;
+  if (maxerr > tol_helix || err[nres] > tol_rg) return;
+
+  convflag = 1;
+  if (comm->me == 0) {
+    char str[256];
+    sprintf(str,"Fix converge: converged at step " BIGINT_FORMAT
+            " after " BIGINT_FORMAT " samples, helix fraction error %g, "
+            "Rg error %g\n",update->ntimestep,nsample,maxerr,err[nres]);
+    utils::logmesg(lmp,str);
+  }
+
+  // same soft stop as fix halt with error soft: the run ends at this step
+
+  if (stopflag) timer->force_timeout();
+}
+
+/* ----------------------------------------------------------------------
+   one sample: helix fraction of each residue and Rg, averaged over the
+   chains with atoms in the group
+   the owner of atom i flags the (i,i+4) contact of its chain, the flags
+   of all atoms are then reduced so every proc applies the -nn pattern
+------------------------------------------------------------------------- */
+
+void FixConverge::measure()
+{
+  double **x = atom->x;
+  int *mask = atom->mask;
+  tagint *tag = atom->tag;
+  imageint *image = atom->image;
+  int nlocal = atom->nlocal;
+  int natoms = nres*nchain;
+
+  for (int k = 0; k < natoms; k++) hcon[k] = 0;
+  for (int k = 0; k < 5*nchain; k++) rgsum[k] = 0.0;
+
+  double xu[3],xc[5][3];
+  int idx[5];
+
+  for (int a = 0; a < nlocal; a++) {
+    if (!(mask[a] & groupbit)) continue;
+    tagint t = tag[a];
+    int c = (t-1) / nres;
+    int p = (t-1) % nres;
+
+    domain->unmap(x[a],image[a],xu);
+    double *r = &rgsum[5*c];
+    r[0] += 1.0;
+    r[1] += xu[0];
+    r[2] += xu[1];
+    r[3] += xu[2];
+    r[4] += xu[0]*xu[0] + xu[1]*xu[1] + xu[2]*xu[2];
+
+    if (p+4 >= nres) continue;
+
+    // chain i..i+4 made whole by closest images, one bond at a time
+
+    idx[0] = a;
+    int inside = 1;
+    for (int m = 1; m < 5; m++) {
+      int j = atom->map(t+m);
+      if (j < 0) error->one(FLERR,"Fix converge atom missing");
+      idx[m] = domain->closest_image(idx[m-1],j);
+      if (!(mask[idx[m]] & groupbit)) inside = 0;
+    }
+    if (!inside) continue;
+    for (int m = 0; m < 5; m++) {
+      xc[m][0] = x[idx[m]][0];
+      xc[m][1] = x[idx[m]][1];
+      xc[m][2] = x[idx[m]][2];
+    }
+
+    double phi1 = dihedral(xc[0],xc[1],xc[2],xc[3]);
+    double phi2 = dihedral(xc[1],xc[2],xc[3],xc[4]);
+    double dx = xc[0][0] - xc[4][0];
+    double dy = xc[0][1] - xc[4][1];
+    double dz = xc[0][2] - xc[4][2];
+    double r14 = sqrt(dx*dx + dy*dy + dz*dz);
+
+    if (phi1 < dlo || phi1 > dhi || phi2 < dlo || phi2 > dhi) continue;
+    if (r14 < r14lo || r14 > r14hi) continue;
+    hcon[t-1] = 1;
+    hcon[t+3] = 1;
+  }
+
+  MPI_Allreduce(hcon,hcon_all,natoms,MPI_INT,MPI_MAX,world);
+  MPI_Allreduce(rgsum,rgsum_all,5*nchain,MPI_DOUBLE,MPI_SUM,world);
+
+  for (int k = 0; k < nobs; k++) sample[k] = 0.0;
+  int nactive = 0;
+
+  for (int c = 0; c < nchain; c++) {
+    double *r = &rgsum_all[5*c];
+    if (r[0] == 0.0) continue;
+    nactive++;
+
+    double cx = r[1]/r[0];
+    double cy = r[2]/r[0];
+    double cz = r[3]/r[0];
+    double rg2 = r[4]/r[0] - cx*cx - cy*cy - cz*cz;
+    sample[nres] += sqrt(MAX(rg2,0.0));
+
+    int *h = &hcon_all[c*nres];
+    for (int p = 0; p < nres; p++) part[p] = 0;
+    for (int i = 0; i+nn <= nres; i++) {
+      int all = 1;
+      for (int j = 0; j < nn; j++)
+        if (!h[i+j]) { all = 0; break; }
+      if (!all) continue;
+      for (int j = 0; j < nn; j++)
+        if (pattern[j]) part[i+j] = 1;
+    }
+    for (int p = 0; p < nres; p++) sample[p] += part[p];
+  }
+
+  if (nactive)
+    for (int k = 0; k < nobs; k++) sample[k] /= nactive;
+}
+
+/* ----------------------------------------------------------------------
+   online block averaging: blocks of blocklen samples, when NBLOCK_MAX
+   blocks are full, neighboring blocks are merged and blocklen doubles
+   (Flyvbjerg-Petersen), so blocks outgrow the correlation time
+------------------------------------------------------------------------- */
+
+void FixConverge::add_sample()
+{
+  nsample++;
+  for (int k = 0; k < nobs; k++) partial[k] += sample[k];
+  if (++npartial < blocklen) return;
+
+  for (int k = 0; k < nobs; k++) {
+    block[nblock][k] = partial[k]/blocklen;
+    partial[k] = 0.0;
+  }
+  npartial = 0;
+  nblock++;
+
+  if (nblock == NBLOCK_MAX) {
+    for (int b = 0; b < NBLOCK_MAX/2; b++)
+      for (int k = 0; k < nobs; k++)
+        block[b][k] = 0.5*(block[2*b][k] + block[2*b+1][k]);
+    nblock = NBLOCK_MAX/2;
+    blocklen *= 2;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   mean and standard error of the mean over the complete blocks
+------------------------------------------------------------------------- */
+
+void FixConverge::statistics()
+{
+  if (nblock < 2) return;
+
+  for (int k = 0; k < nobs; k++) {
+    double sum = 0.0;
+    for (int b = 0; b < nblock; b++) sum += block[b][k];
+    double ave = sum/nblock;
+    double var = 0.0;
+    for (int b = 0; b < nblock; b++)
+      var += (block[b][k] - ave)*(block[b][k] - ave);
+    var /= nblock - 1;
+    mean[k] = ave;
+    err[k] = sqrt(var/nblock);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   same convention as ComputeDihedral of HelixFracDihed15
+------------------------------------------------------------------------- */
+
+double FixConverge::dihedral(double *x1, double *x2, double *x3, double *x4)
+{
+  double b1[3],b2[3],b3[3],n1[3],n2[3],m[3];
+
+  for (int d = 0; d < 3; d++) {
+    b1[d] = x2[d] - x1[d];
+    b2[d] = x2[d] - x3[d];
+    b3[d] = x4[d] - x3[d];
+  }
+
+  n1[0] = b1[1]*b2[2] - b1[2]*b2[1];
+  n1[1] = b1[2]*b2[0] - b1[0]*b2[2];
+  n1[2] = b1[0]*b2[1] - b1[1]*b2[0];
+  n2[0] = b2[1]*b3[2] - b2[2]*b3[1];
+  n2[1] = b2[2]*b3[0] - b2[0]*b3[2];
+  n2[2] = b2[0]*b3[1] - b2[1]*b3[0];
+  m[0] = n1[1]*b2[2] - n1[2]*b2[1];
+  m[1] = n1[2]*b2[0] - n1[0]*b2[2];
+  m[2] = n1[0]*b2[1] - n1[1]*b2[0];
+
+  double rn1 = sqrt(n1[0]*n1[0] + n1[1]*n1[1] + n1[2]*n1[2]);
+  double rn2 = sqrt(n2[0]*n2[0] + n2[1]*n2[1] + n2[2]*n2[2]);
+  double rm = sqrt(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+  if (rn1 == 0.0 || rn2 == 0.0 || rm == 0.0) return 0.0;
+
+  double cx = (n1[0]*n2[0] + n1[1]*n2[1] + n1[2]*n2[2])/(rn1*rn2);
+  double cy = (m[0]*n2[0] + m[1]*n2[1] + m[2]*n2[2])/(rm*rn2);
+  return atan2(cy,cx);
+}
+
+/* ----------------------------------------------------------------------
+   1 = converged, 0 = not yet
+------------------------------------------------------------------------- */
+
+double FixConverge::compute_scalar()
+{
+  return (double) convflag;
+}
+
+/* ----------------------------------------------------------------------
+   1 = mean helix fraction, 2 = largest per-residue error, 3 = mean Rg,
+   4 = Rg error, 5 = # of blocks, 6 = block length (samples)
+------------------------------------------------------------------------- */
+
+double FixConverge::compute_vector(int n)
+{
+  if (n == 0) {
+    double sum = 0.0;
+    for (int p = 0; p < nres; p++) sum += mean[p];
+    return sum/nres;
+  }
+  if (n == 1) {
+    double maxerr = 0.0;
+    for (int p = 0; p < nres; p++) maxerr = MAX(maxerr,err[p]);
+    return maxerr;
+  }
+  if (n == 2) return mean[nres];
+  if (n == 3) return err[nres];
+  if (n == 4) return (double) nblock;
+  return (double) blocklen;
+}
+
+/* ----------------------------------------------------------------------
+   row = residue, 1 = helix fraction, 2 = its error
+------------------------------------------------------------------------- */
+
+double FixConverge::compute_array(int i, int j)
+{
+  if (j == 0) return mean[i];
+  return err[i];
+}
+
+/* ---------------------------------------------------------------------- */
+
+double FixConverge::memory_usage()
+{
+  double bytes = 2.0*nres*nchain * sizeof(int);
+  bytes += 10.0*nchain * sizeof(double);
+  bytes += (double) (NBLOCK_MAX+4)*nobs * sizeof(double);
+  return bytes;
+}
@@ -0,0 +1,108 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Online block averages of the per-residue helix fraction and Rg, with
+   a converged flag for fix halt once their errors are below target
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(converge,FixConverge)
+
+#else
+
+#ifndef LMP_FIX_CONVERGE_H
+#define LMP_FIX_CONVERGE_H
+
+#include "fix.h"
+
+namespace LAMMPS_NS {
+
+class FixConverge : public Fix {
+ public:
+  FixConverge(class LAMMPS *, int, char **);
+  ~FixConverge();
+  int setmask();
+  void init();
+  void end_of_step();
+  double compute_scalar();
+  double compute_vector(int);
+  double compute_array(int, int);
+  double memory_usage();
+
+ protected:
+  int nres;                    // residues per chain
+  int nchain;                  // # of chains, natoms/nres
+  double tol_helix,tol_rg;     // target standard errors
+  double dlo,dhi;              // helical dihedral range (rad)
+  double r14lo,r14hi;          // helical (i,i+4) distance window
+  int nn;                      // length of the -nn pattern
+  int *pattern;                // 1 = residue of the window is helical
+  bigint nstart;               // no samples before this step
+  int nblock_min;              // blocks needed for a decision
+  int len_min;                 // shortest block (samples) for a decision
+  int stopflag;                // 1 = stop the run itself when converged
+
+  int *hcon,*hcon_all;         // 1 = residue of the atom ID is in a
+                               // helical (i,i+4) contact
+  int *part;                   // helical residues of one chain
+  double *rgsum,*rgsum_all;    // per chain n, sum x, sum x^2
+  double *sample;              // current helix fractions and Rg
+
+  int nobs;                    // nres helix fractions + Rg
+  double **block;              // block means
+  double *partial;             // sums of the block being filled
+  int nblock,blocklen,npartial;
+  bigint nsample;
+  double *mean,*err;
+  int convflag;
+
+  void measure();
+  void add_sample();
+  void statistics();
+  double dihedral(double *, double *, double *, double *);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix converge requires atom IDs
+
+Residues and chains are defined by the atom IDs.
+
+E: Fix converge requires an atom map, see atom_modify
+
+Self-explanatory.
+
+E: Fix converge chain length does not divide the number of atoms
+
+Atom IDs 1 to N are the first chain, N+1 to 2N the second, etc.
+
+E: Fix converge pattern length does not match nn
+
+The pattern has one 0/1 digit per residue of the window.
+
+E: Fix converge atom missing
+
+An atom within 5 residues along the chain of an owned atom is neither
+owned nor a ghost.  Increase the communication cutoff.
+
+*/
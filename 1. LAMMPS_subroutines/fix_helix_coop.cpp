@@ -0,0 +1,331 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include <cstring>
+#include "fix_helix_coop.h"
+#include "atom.h"
+#include "domain.h"
+#include "update.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ----------------------------------------------------------------------
+   fix ID group helix/coop eps rlo rhi width keyword value ...
+     contact k = CA pair (k,k+4) in the same molecule, both in group
+     s_k = 1 for rlo <= r <= rhi, smoothly to 0 within width outside
+     E = -eps sum_k s_k - eps_c sum_k s_k s_k+1
+     coop eps_c = cooperativity between consecutive contacts (default 0)
+   rlo/rhi are the same r14 window as the -r14 option of HelixFracDihed15
+------------------------------------------------------------------------- */
+
+FixHelixCoop::FixHelixCoop(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg), molfirst(NULL), mollast(NULL)
+{
+  if (narg < 7) error->all(FLERR,"Illegal fix helix/coop command");
+
+  eps = utils::numeric(FLERR,arg[3],false,lmp);
+  rlo = utils::numeric(FLERR,arg[4],false,lmp);
+  rhi = utils::numeric(FLERR,arg[5],false,lmp);
+  width = utils::numeric(FLERR,arg[6],false,lmp);
+  if (rlo < 0.0 || rhi <= rlo || width <= 0.0)
+    error->all(FLERR,"Illegal fix helix/coop command");
+
+  eps_coop = 0.0;
+
+  int iarg = 7;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"coop") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix helix/coop command");
+      eps_coop = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix helix/coop command");
+  }
+
+  if (atom->tag_enable == 0)
+    error->all(FLERR,"Fix helix/coop requires atom IDs");
+  if (atom->map_style == 0)
+    error->all(FLERR,"Fix helix/coop requires an atom map, see atom_modify");
+
+  scalar_flag = 1;
+  vector_flag = 1;
+  size_vector = 2;
+  global_freq = 1;
+  extscalar = 1;
+  extvector = -1;
+  extlist = new int[2];
+  extlist[0] = 1;
+  extlist[1] = 0;
+
+  // fix_modify energy yes / virial yes add the term to thermo output
+
+  virial_flag = 1;
+
+  energy = 0.0;
+  count[0] = count[1] = 0.0;
+  eflag_reduced = 0;
+  nmol = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixHelixCoop::~FixHelixCoop()
+{
+  delete [] extlist;
+  memory->destroy(molfirst);
+  memory->destroy(mollast);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixHelixCoop::setmask()
+{
+  int mask = 0;
+  mask |= POST_FORCE;
+  mask |= THERMO_ENERGY;
+  mask |= MIN_POST_FORCE;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixHelixCoop::init()
+{
+  if (atom->map_style == 0)
+    error->all(FLERR,"Fix helix/coop requires an atom map, see atom_modify");
+
+  // atoms may have been added since the last run
+
+  if (atom->molecule_flag) setup_molecules();
+}
+
+/* ----------------------------------------------------------------------
+   first and last atom ID of each molecule, so a contact that crosses
+   into the next chain is recognized without its atoms being present
+   molecule ID 0 (no molecule) is kept as one range like any other
+------------------------------------------------------------------------- */
+
+void FixHelixCoop::setup_molecules()
+{
+  tagint *molecule = atom->molecule;
+  tagint *tag = atom->tag;
+  int nlocal = atom->nlocal;
+
+  tagint maxone = 0, maxall;
+  for (int i = 0; i < nlocal; i++) maxone = MAX(maxone,molecule[i]);
+  MPI_Allreduce(&maxone,&maxall,1,MPI_LMP_TAGINT,MPI_MAX,world);
+  if (maxall >= MAXSMALLINT/2)
+    error->all(FLERR,"Too many molecules for fix helix/coop");
+  nmol = static_cast<int> (maxall);
+
+  memory->destroy(molfirst);
+  memory->destroy(mollast);
+  memory->create(molfirst,nmol+1,"helix/coop:molfirst");
+  memory->create(mollast,nmol+1,"helix/coop:mollast");
+
+  tagint *first,*last;
+  memory->create(first,nmol+1,"helix/coop:first");
+  memory->create(last,nmol+1,"helix/coop:last");
+  for (int m = 0; m <= nmol; m++) {
+    first[m] = MAXSMALLINT;
+    last[m] = 0;
+  }
+  for (int i = 0; i < nlocal; i++) {
+    first[molecule[i]] = MIN(first[molecule[i]],tag[i]);
+    last[molecule[i]] = MAX(last[molecule[i]],tag[i]);
+  }
+  MPI_Allreduce(first,molfirst,nmol+1,MPI_LMP_TAGINT,MPI_MIN,world);
+  MPI_Allreduce(last,mollast,nmol+1,MPI_LMP_TAGINT,MPI_MAX,world);
+  memory->destroy(first);
+  memory->destroy(last);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixHelixCoop::setup(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixHelixCoop::min_setup(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ----------------------------------------------------------------------
+   switched contact k = (itag,itag+4), del = x_k - x_k+4 (closest image)
+   returns 0 if there is no such contact, else s and ds/dr
+------------------------------------------------------------------------- */
+
+int FixHelixCoop::contact(tagint itag, double *del, double &s, double &dsdr)
+{
+  if (itag < 1 || itag+4 > atom->map_tag_max) return 0;
+
+  int i = atom->map(itag);
+  int j = atom->map(itag+4);
+
+  // a missing end of a contact in another chain is no error,
+  // only atoms of the same molecule must be owned or ghosts
+
+  if (atom->molecule_flag) {
+    if (i < 0 && j < 0) return 0;
+    tagint m = atom->molecule[(i >= 0) ? i : j];
+    if (m > nmol || itag < molfirst[m] || itag+4 > mollast[m]) return 0;
+  }
+  if (i < 0 || j < 0) error->one(FLERR,"Fix helix/coop atom missing");
+
+  if (atom->molecule_flag && atom->molecule[i] != atom->molecule[j]) return 0;
+  if (!(atom->mask[i] & groupbit) || !(atom->mask[j] & groupbit)) return 0;
+
+  double **x = atom->x;
+  j = domain->closest_image(i,j);
+  del[0] = x[i][0] - x[j][0];
+  del[1] = x[i][1] - x[j][1];
+  del[2] = x[i][2] - x[j][2];
+  double r = sqrt(del[0]*del[0] + del[1]*del[1] + del[2]*del[2]);
+
+  // smoothstep 1 - 3t^2 + 2t^3 on either side of the window
+
+  double t;
+  if (r < rlo - width || r > rhi + width) {
+    s = dsdr = 0.0;
+  } else if (r < rlo) {
+    t = (rlo - r)/width;
+    s = 1.0 - t*t*(3.0 - 2.0*t);
+    dsdr = 6.0*t*(1.0 - t)/width;
+  } else if (r > rhi) {
+    t = (r - rhi)/width;
+    s = 1.0 - t*t*(3.0 - 2.0*t);
+    dsdr = -6.0*t*(1.0 - t)/width;
+  } else {
+    s = 1.0;
+    dsdr = 0.0;
+  }
+
+  // dsdr/r applied to del gives the gradient wrt x_k
+
+  if (r > 0.0) dsdr /= r;
+  else dsdr = 0.0;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   each owned atom a gets the full gradient of the contacts it belongs to,
+   k = a (first atom) and k = a-4 (second atom), so no reverse comm is
+   needed; energy and virial of contact k are tallied by the owner of k
+------------------------------------------------------------------------- */
+
+void FixHelixCoop::post_force(int vflag)
+{
+  double **f = atom->f;
+  int *mask = atom->mask;
+  tagint *tag = atom->tag;
+  int nlocal = atom->nlocal;
+
+  v_init(vflag);
+
+  energy = 0.0;
+  count[0] = count[1] = 0.0;
+  eflag_reduced = 0;
+
+  double del[3],delm[3],delp[3],fk[3],v[6];
+  double s,dsdr,sm,dsm,sp,dsp,dEds;
+  int has,hasm,hasp;
+
+  for (int a = 0; a < nlocal; a++) {
+    if (!(mask[a] & groupbit)) continue;
+    tagint t = tag[a];
+
+    for (int side = 0; side < 2; side++) {
+      tagint k = (side == 0) ? t : t-4;
+      has = contact(k,del,s,dsdr);
+      if (!has) continue;
+
+      hasm = contact(k-1,delm,sm,dsm);
+      hasp = contact(k+1,delp,sp,dsp);
+      if (!hasm) sm = 0.0;
+      if (!hasp) sp = 0.0;
+
+      dEds = -eps - eps_coop*(sm + sp);
+
+      // force on the first atom of contact k, opposite on the second
+
+      fk[0] = -dEds*dsdr*del[0];
+      fk[1] = -dEds*dsdr*del[1];
+      fk[2] = -dEds*dsdr*del[2];
+
+      if (side == 0) {
+        f[a][0] += fk[0];
+        f[a][1] += fk[1];
+        f[a][2] += fk[2];
+
+        energy -= eps*s + eps_coop*s*sp;
+        count[0] += s;
+        count[1] += 1.0;
+
+        if (evflag) {
+          v[0] = del[0]*fk[0];
+          v[1] = del[1]*fk[1];
+          v[2] = del[2]*fk[2];
+          v[3] = del[0]*fk[1];
+          v[4] = del[0]*fk[2];
+          v[5] = del[1]*fk[2];
+          v_tally(a,v);
+        }
+      } else {
+        f[a][0] -= fk[0];
+        f[a][1] -= fk[1];
+        f[a][2] -= fk[2];
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixHelixCoop::min_post_force(int vflag)
+{
+  post_force(vflag);
+}
+
+/* ----------------------------------------------------------------------
+   potential energy of all contacts
+------------------------------------------------------------------------- */
+
+double FixHelixCoop::compute_scalar()
+{
+  if (eflag_reduced == 0) {
+    MPI_Allreduce(&energy,&energy_all,1,MPI_DOUBLE,MPI_SUM,world);
+    MPI_Allreduce(count,count_all,2,MPI_DOUBLE,MPI_SUM,world);
+    eflag_reduced = 1;
+  }
+  return energy_all;
+}
+
+/* ----------------------------------------------------------------------
+   1 = sum of s_k (formed contacts), 2 = fraction of contacts formed
+------------------------------------------------------------------------- */
+
+double FixHelixCoop::compute_vector(int n)
+{
+  compute_scalar();
+  if (n == 0) return count_all[0];
+  if (count_all[1] > 0.0) return count_all[0]/count_all[1];
+  return 0.0;
+}
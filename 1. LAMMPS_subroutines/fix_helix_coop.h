@@ -0,0 +1,86 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Hydrogen-bond-like i->i+4 CA contact term with optional cooperativity
+   between consecutive contacts, evaluated from the chain topology (tags)
+   without a neighbor list
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(helix/coop,FixHelixCoop)
+
+#else
+
+#ifndef LMP_FIX_HELIX_COOP_H
+#define LMP_FIX_HELIX_COOP_H
+
+#include "fix.h"
+
+namespace LAMMPS_NS {
+
+class FixHelixCoop : public Fix {
+ public:
+  FixHelixCoop(class LAMMPS *, int, char **);
+  ~FixHelixCoop();
+  int setmask();
+  void init();
+  void setup(int);
+  void min_setup(int);
+  void post_force(int);
+  void min_post_force(int);
+  double compute_scalar();
+  double compute_vector(int);
+
+ protected:
+  double eps,eps_coop;         // contact and cooperativity strength
+  double rlo,rhi,width;        // r14 window and switching width
+  double energy,energy_all;
+  double count[2],count_all[2];
+  int eflag_reduced;
+  int nmol;                    // largest molecule ID
+  tagint *molfirst,*mollast;   // atom ID range of each molecule
+
+  void setup_molecules();
+  int contact(tagint, double *, double &, double &);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix helix/coop requires atom IDs
+
+Contacts are defined by the i -> i+4 atom IDs along the chain.
+
+E: Fix helix/coop requires an atom map, see atom_modify
+
+Self-explanatory.
+
+E: Fix helix/coop atom missing
+
+An atom within 5 residues along the chain of an owned atom is neither
+owned nor a ghost.  Increase the communication cutoff.
+
+E: Too many molecules for fix helix/coop
+
+The atom ID ranges are stored per molecule ID.
+
+*/
@@ -0,0 +1,433 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "fix_sim_temper.h"
+#include "atom.h"
+#include "update.h"
+#include "force.h"
+#include "modify.h"
+#include "compute.h"
+#include "comm.h"
+#include "random_park.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+#define MAXLINE 256
+
+enum{GEOM,LINEAR};
+
+/* ----------------------------------------------------------------------
+   fix ID group sim/temper N fix-ID seed Tlo Thi ntemp keyword value ...
+     every N steps a move to a neighboring temperature of the ladder is
+     accepted with min(1, exp((b_i - b_j) U + lnw_j - lnw_i)), U = total
+     potential energy (pair + bond + bch + gaussian + fixes)
+     fix-ID = thermostat whose target is moved, velocities of the group
+     are rescaled by sqrt(T_j/T_i) on acceptance
+     spacing geom/linear = ladder spacing (default geom)
+     start k = initial temperature index, 1 = Tlo (default 1)
+     wl lnf0 lnfmin flat = Wang-Landau increment, final increment and
+       flatness of the visit histogram (default 1.0 1.0e-5 0.8)
+     wl no = keep the weights fixed
+     weights file = initial ln weights, one "T lnw" line per temperature
+     pe ID = potential energy compute (default thermo_pe)
+     file name = ladder state written at each ln f reduction and run end
+   without weights, lnw_k = U/kT_k at the first attempt, so the first
+   moves are accepted at the starting energy and Wang-Landau does the rest
+------------------------------------------------------------------------- */
+
+FixSimTemper::FixSimTemper(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg),
+  temp(NULL), lnw(NULL), hist(NULL), random(NULL),
+  id_fix(NULL), id_pe(NULL), thermostat(NULL), pe(NULL), wfile(NULL)
+{
+  if (narg < 9) error->all(FLERR,"Illegal fix sim/temper command");
+
+  nevery = utils::inumeric(FLERR,arg[3],false,lmp);
+  if (nevery <= 0) error->all(FLERR,"Illegal fix sim/temper command");
+
+  int n = strlen(arg[4]) + 1;
+  id_fix = new char[n];
+  strcpy(id_fix,arg[4]);
+
+  seed = utils::inumeric(FLERR,arg[5],false,lmp);
+  double tlo = utils::numeric(FLERR,arg[6],false,lmp);
+  double thi = utils::numeric(FLERR,arg[7],false,lmp);
+  ntemp = utils::inumeric(FLERR,arg[8],false,lmp);
+  if (seed <= 0 || tlo <= 0.0 || thi < tlo || ntemp < 2)
+    error->all(FLERR,"Illegal fix sim/temper command");
+
+  int spacing = GEOM;
+  itemp = 0;
+  wlflag = 1;
+  lnf = 1.0;
+  lnf_min = 1.0e-5;
+  flatness = 0.8;
+  char *weightsfile = NULL;
+
+  int iarg = 9;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"spacing") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      if (strcmp(arg[iarg+1],"geom") == 0) spacing = GEOM;
+      else if (strcmp(arg[iarg+1],"linear") == 0) spacing = LINEAR;
+      else error->all(FLERR,"Illegal fix sim/temper command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"start") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      itemp = utils::inumeric(FLERR,arg[iarg+1],false,lmp) - 1;
+      if (itemp < 0 || itemp >= ntemp)
+        error->all(FLERR,"Illegal fix sim/temper command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"wl") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      if (strcmp(arg[iarg+1],"no") == 0) {
+        wlflag = 0;
+        iarg += 2;
+      } else {
+        if (iarg+4 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+        wlflag = 1;
+        lnf = utils::numeric(FLERR,arg[iarg+1],false,lmp);
+        lnf_min = utils::numeric(FLERR,arg[iarg+2],false,lmp);
+        flatness = utils::numeric(FLERR,arg[iarg+3],false,lmp);
+        if (lnf <= 0.0 || lnf_min <= 0.0 || flatness <= 0.0 || flatness >= 1.0)
+          error->all(FLERR,"Illegal fix sim/temper command");
+        iarg += 4;
+      }
+    } else if (strcmp(arg[iarg],"weights") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      weightsfile = arg[iarg+1];
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"pe") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      delete [] id_pe;
+      n = strlen(arg[iarg+1]) + 1;
+      id_pe = new char[n];
+      strcpy(id_pe,arg[iarg+1]);
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"file") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix sim/temper command");
+      delete [] wfile;
+      n = strlen(arg[iarg+1]) + 1;
+      wfile = new char[n];
+      strcpy(wfile,arg[iarg+1]);
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix sim/temper command");
+  }
+
+  if (id_pe == NULL) {
+    id_pe = new char[10];
+    strcpy(id_pe,"thermo_pe");
+  }
+
+  memory->create(temp,ntemp,"sim/temper:temp");
+  memory->create(lnw,ntemp,"sim/temper:lnw");
+  memory->create(hist,ntemp,"sim/temper:hist");
+
+  for (int k = 0; k < ntemp; k++) {
+    double frac = (double) k / (ntemp-1);
+    if (spacing == GEOM) temp[k] = tlo * pow(thi/tlo,frac);
+    else temp[k] = tlo + (thi-tlo)*frac;
+    lnw[k] = hist[k] = 0.0;
+  }
+  lnwflag = 0;
+
+  // initial weights, proc 0 reads and bcasts
+
+  if (weightsfile) {
+    int flag = 0;
+    if (comm->me == 0) {
+      FILE *fp = fopen(weightsfile,"r");
+      if (fp == NULL) flag = -1;
+      else {
+        char line[MAXLINE];
+        double t;
+        int k = 0;
+        while (k < ntemp && fgets(line,MAXLINE,fp)) {
+          if (line[strspn(line," \t")] == '#') continue;
+          if (sscanf(line,"%lg %lg",&t,&lnw[k]) != 2) continue;
+          if (fabs(t-temp[k]) > 1.0e-3*temp[k]) break;
+          k++;
+        }
+        fclose(fp);
+        if (k < ntemp) flag = -2;
+      }
+    }
+    MPI_Bcast(&flag,1,MPI_INT,0,world);
+    if (flag == -1) {
+      char str[128];
+      snprintf(str,128,"Cannot open fix sim/temper weights file %s",weightsfile);
+      error->all(FLERR,str);
+    }
+    if (flag == -2) error->all(FLERR,"Invalid fix sim/temper weights file");
+    MPI_Bcast(lnw,ntemp,MPI_DOUBLE,0,world);
+    lnwflag = 1;
+  }
+
+  random = new RanPark(lmp,seed);
+
+  scalar_flag = 1;
+  vector_flag = 1;
+  size_vector = 4;
+  global_freq = 1;
+  extscalar = 0;
+  extvector = 0;
+  restart_global = 1;
+
+  nattempt = naccept = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixSimTemper::~FixSimTemper()
+{
+  delete [] id_fix;
+  delete [] id_pe;
+  delete [] wfile;
+  delete random;
+  memory->destroy(temp);
+  memory->destroy(lnw);
+  memory->destroy(hist);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixSimTemper::setmask()
+{
+  int mask = 0;
+  mask |= END_OF_STEP;
+  mask |= POST_RUN;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSimTemper::init()
+{
+  int ifix = modify->find_fix(id_fix);
+  if (ifix < 0) error->all(FLERR,"Fix sim/temper thermostat fix ID does not exist");
+  thermostat = modify->fix[ifix];
+
+  int dim;
+  if (thermostat->extract("t_target",dim) == NULL)
+    error->all(FLERR,"Fix sim/temper thermostat does not support a target temperature");
+
+  int icompute = modify->find_compute(id_pe);
+  if (icompute < 0)
+    error->all(FLERR,"Fix sim/temper potential energy compute ID does not exist");
+  pe = modify->compute[icompute];
+  if (pe->peflag == 0)
+    error->all(FLERR,"Fix sim/temper compute does not compute potential energy");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSimTemper::setup(int /*vflag*/)
+{
+  thermostat->reset_target(temp[itemp]);
+
+  // end_of_step() fires on multiples of N, also after minimize or an odd run
+
+  bigint next = (update->ntimestep/nevery)*nevery + nevery;
+  pe->addstep(next);
+}
+
+/* ----------------------------------------------------------------------
+   one move attempt; U and the random numbers are the same on all procs,
+   so every proc takes the same decision
+------------------------------------------------------------------------- */
+
+void FixSimTemper::end_of_step()
+{
+  double u = pe->compute_scalar();
+  pe->addstep(update->ntimestep + nevery);
+
+  double boltz = force->boltz;
+
+  if (!lnwflag) {
+    for (int k = 0; k < ntemp; k++)
+      lnw[k] = u/(boltz*temp[k]) - u/(boltz*temp[0]);
+    lnwflag = 1;
+  }
+
+  int jtemp = (random->uniform() < 0.5) ? itemp-1 : itemp+1;
+  nattempt++;
+
+  if (jtemp >= 0 && jtemp < ntemp) {
+    double delta = u*(1.0/(boltz*temp[itemp]) - 1.0/(boltz*temp[jtemp])) +
+      lnw[jtemp] - lnw[itemp];
+    if (delta >= 0.0 || random->uniform() < exp(delta)) {
+      double scale = sqrt(temp[jtemp]/temp[itemp]);
+      double **v = atom->v;
+      int *mask = atom->mask;
+      int nlocal = atom->nlocal;
+      for (int i = 0; i < nlocal; i++)
+        if (mask[i] & groupbit) {
+          v[i][0] *= scale;
+          v[i][1] *= scale;
+          v[i][2] *= scale;
+        }
+      itemp = jtemp;
+      thermostat->reset_target(temp[itemp]);
+      naccept++;
+    }
+  }
+
+  // Wang-Landau: penalize the visited temperature, halve ln f once
+  // the visits are flat, weights are frozen below lnf_min
+
+  hist[itemp] += 1.0;
+  if (!wlflag) return;
+
+  lnw[itemp] -= lnf;
+  if (flat()) {
+    lnf *= 0.5;
+    for (int k = 0; k < ntemp; k++) hist[k] = 0.0;
+    if (lnf < lnf_min) wlflag = 0;
+    if (comm->me == 0) {
+      char str[128];
+      sprintf(str,"Fix sim/temper: ln f = %g at step " BIGINT_FORMAT "%s\n",
+              lnf,update->ntimestep,wlflag ? "" : ", weights frozen");
+      utils::logmesg(lmp,str);
+    }
+    write_weights();
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixSimTemper::post_run()
+{
+  write_weights();
+}
+
+/* ----------------------------------------------------------------------
+   1 if every temperature was visited at least flatness x the mean
+------------------------------------------------------------------------- */
+
+int FixSimTemper::flat()
+{
+  double sum = 0.0, min = hist[0];
+  for (int k = 0; k < ntemp; k++) {
+    sum += hist[k];
+    min = MIN(min,hist[k]);
+  }
+  if (min <= 0.0) return 0;
+  return (min >= flatness*sum/ntemp) ? 1 : 0;
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 writes "T lnw visits" per temperature, readable by weights
+------------------------------------------------------------------------- */
+
+void FixSimTemper::write_weights()
+{
+  if (wfile == NULL || comm->me != 0) return;
+
+  FILE *fp = fopen(wfile,"w");
+  if (fp == NULL) {
+    char str[128];
+    snprintf(str,128,"Cannot open fix sim/temper file %s",wfile);
+    error->one(FLERR,str);
+  }
+  fprintf(fp,"# step " BIGINT_FORMAT " ln_f %g acceptance %g\n",
+          update->ntimestep,wlflag ? lnf : 0.0,
+          nattempt ? (double) naccept/nattempt : 0.0);
+  for (int k = 0; k < ntemp; k++)
+    fprintf(fp,"%g %.10g %g\n",temp[k],lnw[k]-lnw[0],hist[k]);
+  fclose(fp);
+}
+
+/* ----------------------------------------------------------------------
+   pack ladder state into restart file
+------------------------------------------------------------------------- */
+
+void FixSimTemper::write_restart(FILE *fp)
+{
+  int n = 7 + 2*ntemp;
+  double *list = new double[n];
+  list[0] = ntemp;
+  list[1] = itemp;
+  list[2] = lnf;
+  list[3] = wlflag;
+  list[4] = lnwflag;
+  list[5] = nattempt;
+  list[6] = naccept;
+  for (int k = 0; k < ntemp; k++) {
+    list[7+k] = lnw[k];
+    list[7+ntemp+k] = hist[k];
+  }
+
+  if (comm->me == 0) {
+    int size = n * sizeof(double);
+    fwrite(&size,sizeof(int),1,fp);
+    fwrite(list,sizeof(double),n,fp);
+  }
+  delete [] list;
+}
+
+/* ----------------------------------------------------------------------
+   use state info from restart file to restart the fix
+------------------------------------------------------------------------- */
+
+void FixSimTemper::restart(char *buf)
+{
+  double *list = (double *) buf;
+
+  if (static_cast<int> (list[0]) != ntemp) {
+    error->warning(FLERR,"Fix sim/temper restart has a different ladder, "
+                   "weights are not restored");
+    return;
+  }
+
+  itemp = static_cast<int> (list[1]);
+  lnf = list[2];
+  wlflag = static_cast<int> (list[3]);
+  lnwflag = static_cast<int> (list[4]);
+  nattempt = static_cast<bigint> (list[5]);
+  naccept = static_cast<bigint> (list[6]);
+  for (int k = 0; k < ntemp; k++) {
+    lnw[k] = list[7+k];
+    hist[k] = list[7+ntemp+k];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   current temperature
+------------------------------------------------------------------------- */
+
+double FixSimTemper::compute_scalar()
+{
+  return temp[itemp];
+}
+
+/* ----------------------------------------------------------------------
+   1 = temperature index (1 = Tlo), 2 = temperature,
+   3 = Wang-Landau ln f (0 once frozen), 4 = acceptance ratio
+------------------------------------------------------------------------- */
+
+double FixSimTemper::compute_vector(int n)
+{
+  if (n == 0) return itemp + 1;
+  if (n == 1) return temp[itemp];
+  if (n == 2) return wlflag ? lnf : 0.0;
+  if (nattempt == 0) return 0.0;
+  return (double) naccept / nattempt;
+}
@@ -0,0 +1,117 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Simulated tempering of one system on a temperature ladder, with
+   Wang-Landau estimation of the ladder weights; single-process
+   alternative to temper for short chains
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(sim/temper,FixSimTemper)
+
+#else
+
+#ifndef LMP_FIX_SIM_TEMPER_H
+#define LMP_FIX_SIM_TEMPER_H
+
+#include "fix.h"
+
+namespace LAMMPS_NS {
+
+class FixSimTemper : public Fix {
+ public:
+  FixSimTemper(class LAMMPS *, int, char **);
+  ~FixSimTemper();
+  int setmask();
+  void init();
+  void setup(int);
+  void end_of_step();
+  void post_run();
+  void write_restart(FILE *);
+  void restart(char *);
+  double compute_scalar();
+  double compute_vector(int);
+
+ protected:
+  int ntemp;                   // # of temperatures of the ladder
+  double *temp;                // ladder temperatures
+  double *lnw;                 // ln weight of each temperature
+  double *hist;                // visits since the last ln f reduction
+  int itemp;                   // current temperature
+  int seed;
+  class RanPark *random;
+
+  char *id_fix,*id_pe;
+  class Fix *thermostat;
+  class Compute *pe;
+
+  int wlflag;                  // 1 = weights still updated
+  double lnf,lnf_min;          // Wang-Landau increment and final value
+  double flatness;
+  int lnwflag;                 // 1 = weights set by file, restart or run
+  char *wfile;                 // ladder state written here, NULL = none
+
+  bigint nattempt,naccept;
+
+  int flat();
+  void write_weights();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix sim/temper thermostat fix ID does not exist
+
+Self-explanatory.
+
+E: Fix sim/temper thermostat does not support a target temperature
+
+The thermostat fix must expose t_target, e.g. fix langevin, nvt or
+temp/berendsen.
+
+E: Fix sim/temper potential energy compute ID does not exist
+
+Self-explanatory.
+
+E: Fix sim/temper compute does not compute potential energy
+
+The pe keyword needs a compute of style pe.
+
+E: Cannot open fix sim/temper weights file %s
+
+The file of the weights keyword cannot be read.
+
+E: Invalid fix sim/temper weights file
+
+Each line has one temperature of the ladder and its ln weight, in the
+order of the ladder.
+
+E: Cannot open fix sim/temper file %s
+
+The file of the file keyword cannot be written.
+
+W: Fix sim/temper restart has a different ladder, weights are not restored
+
+The number of temperatures in the restart file does not match the
+command, the weights start from their initial estimate.
+
+*/
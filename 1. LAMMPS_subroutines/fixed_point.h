@@ -0,0 +1,82 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Deterministic force summation for the HPS-SS styles ("fixed yes"):
+   every contribution is rounded to an integer multiple of 2^-32 and summed
+   as 64-bit integers, so the per-style force on an atom does not depend on
+   the order (neighbor list, threads, vector lanes) in which it was added
+   a single contribution is limited to |x| < 2^20 (kcal/mol/A), so 2^11
+   of them still sum within the 64-bit range; larger values are clamped
+   and flagged in oflow, the caller stops with an error
+------------------------------------------------------------------------- */
+
+#ifndef LMP_FIXED_POINT_H
+#define LMP_FIXED_POINT_H
+
+#include <cmath>
+#include "lmptype.h"
+#include "memory.h"
+
+namespace LAMMPS_NS {
+
+namespace FixedPoint {
+  static const double SCALE = 4294967296.0;              // 2^32
+  static const double INVSCALE = 1.0/4294967296.0;
+  static const double LIMIT = 1048576.0;                 // 2^20
+
+  // NaN fails the test too, llrint() never sees an out-of-range value
+
+  inline bigint to_fixed(double x, int &oflow) {
+    if (!(fabs(x) < LIMIT)) {
+      oflow = 1;
+      return 0;
+    }
+    return static_cast<bigint> (llrint(x*SCALE));
+  }
+
+  inline void add(bigint *a, double x, double y, double z, int &oflow) {
+    a[0] += to_fixed(x,oflow);
+    a[1] += to_fixed(y,oflow);
+    a[2] += to_fixed(z,oflow);
+  }
+
+  inline void sub(bigint *a, double x, double y, double z, int &oflow) {
+    a[0] -= to_fixed(x,oflow);
+    a[1] -= to_fixed(y,oflow);
+    a[2] -= to_fixed(z,oflow);
+  }
+
+  // grow buffer to nmax atoms if needed, zero the first n
+
+  inline void setup(Memory *memory, bigint **&buf, int &nmax_buf,
+                    int nmax, int n, const char *name) {
+    if (nmax > nmax_buf) {
+      memory->destroy(buf);
+      nmax_buf = nmax;
+      memory->create(buf,nmax_buf,3,name);
+    }
+    for (int i = 0; i < n; i++) buf[i][0] = buf[i][1] = buf[i][2] = 0;
+  }
+
+  // one rounding per atom and style when adding to the force array
+
+  inline void flush(double **f, bigint **buf, int n) {
+    for (int i = 0; i < n; i++) {
+      f[i][0] += buf[i][0]*INVSCALE;
+      f[i][1] += buf[i][1]*INVSCALE;
+      f[i][2] += buf[i][2]*INVSCALE;
+    }
+  }
+}
+
+}
+
+#endif
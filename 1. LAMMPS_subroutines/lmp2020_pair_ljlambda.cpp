@@ -21,19 +21,61 @@
 #include "force.h"
 #include "neighbor.h"
 #include "neigh_list.h"
+#include "kspace.h"
+#include "update.h"
 #include "math_const.h"
 #include "memory.h"
 #include "error.h"
 #include "utils.h"
+#include "fixed_point.h"
+#include "rigid_body.h"
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 using namespace LAMMPS_NS;
 using namespace MathConst;
 
+#define EWALD_F   1.12837917
+#define NTRIAL    3
+#define KERNELTOL 1.0e-6
+#define NCHUNK    8            // chunks per thread of the omp kernels
+
+enum{FULL,PRUNE,OMP,OMP_PRUNE,AUTO};
+static const char *kernelnames[] = {"full","prune","omp","omp/prune"};
+
 /* ---------------------------------------------------------------------- */
 
 PairLJLambda::PairLJLambda(LAMMPS *lmp) : Pair(lmp)
 {
   writedata = 1;
+  pppmflag = 1;
+  longflag = 0;
+  g_ewald = 0.0;
+  typecount = NULL;
+  typeqmax = NULL;
+  fixedflag = 0;
+  ffix = NULL;
+  nmax_fix = 0;
+  kernelflag = FULL;
+  kernel = FULL;
+  prune_every = 4;
+  prune_buffer = 1.0;
+  inner_numneigh = NULL;
+  inner_firstneigh = NULL;
+  inner_neigh = NULL;
+  xprune = NULL;
+  nmax_prune = 0;
+  maxinner = 0;
+  lastprune = -1;
+  idbody = NULL;
+  ibody = -1;
+  fthr = NULL;
+  nmax_thr = 0;
+  nthr = 0;
+  chunk_lo = chunk_next = chunk_end = NULL;
+  maxchunk = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -56,43 +98,390 @@ PairLJLambda::~PairLJLambda()
     memory->destroy(lj4);
     memory->destroy(offset);
     memory->destroy(lambda); //JM
+    memory->destroy(typecount);
+    memory->destroy(typeqmax);
+    memory->destroy(cutprunesq);
   }
+  memory->destroy(ffix);
+  memory->destroy(inner_numneigh);
+  memory->sfree(inner_firstneigh);
+  memory->destroy(inner_neigh);
+  memory->destroy(xprune);
+  delete [] idbody;
+  memory->destroy(fthr);
+  memory->destroy(chunk_lo);
+  memory->destroy(chunk_next);
+  memory->destroy(chunk_end);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairLJLambda::compute(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  int nall = atom->nlocal + atom->nghost;
+
+  // deterministic mode: sum forces as fixed-point integers, add to f at end
+
+  if (fixedflag)
+    FixedPoint::setup(memory,ffix,nmax_fix,atom->nmax,nall,"pair:ffix");
+
+  // auto mode: pick the kernel on the first evaluation after init
+
+  if (kernel < 0) tune_kernel();
+
+  int inum = list->inum;
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+
+  // pruned mode: re-prune after each rebuild, every prune_every steps and
+  // as soon as an atom moved by half the buffer, in between the kernel
+  // only sees pairs within cutoff + buffer
+
+  // rigid bodies: pairs inside one body are dropped from the inner list
+  // after each rebuild instead of being tested in the kernel
+
+  if (kernel == PRUNE || kernel == OMP_PRUNE) {
+    if (lastprune < 0 || neighbor->ago == 0 ||
+        neighbor->ago % prune_every == 0 || prune_check()) prune(1);
+    numneigh = inner_numneigh;
+    firstneigh = inner_firstneigh;
+  } else if (idbody) {
+    if (lastprune < 0 || neighbor->ago == 0) prune(0);
+    numneigh = inner_numneigh;
+    firstneigh = inner_firstneigh;
+  }
+
+  dispatch(inum,ilist,numneigh,firstneigh);
+
+  if (fixedflag) FixedPoint::flush(atom->f,ffix,nall);
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   per-atom tallies go through ev_tally(), global energy and virial
+   are accumulated in registers and reduced once per i atom
+   the omp kernels thread the global-only variants, per-atom tallies and
+   fixed-point sums stay serial
+------------------------------------------------------------------------- */
+
+void PairLJLambda::dispatch(int inum, int *ilist, int *numneigh,
+                            int **firstneigh)
+{
+  double acc[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  const int threaded = (kernel == OMP || kernel == OMP_PRUNE) && !fixedflag;
+
+  if (eflag_atom || vflag_atom) {
+    if (force->newton_pair) eval<1,0,0,1>(0,inum,ilist,numneigh,firstneigh,atom->f,acc);
+    else eval<1,0,0,0>(0,inum,ilist,numneigh,firstneigh,atom->f,acc);
+  } else if (eflag_global) {
+    if (vflag_global) {
+      if (force->newton_pair) run<1,1,1>(threaded,inum,ilist,numneigh,firstneigh,acc);
+      else run<1,1,0>(threaded,inum,ilist,numneigh,firstneigh,acc);
+    } else {
+      if (force->newton_pair) run<1,0,1>(threaded,inum,ilist,numneigh,firstneigh,acc);
+      else run<1,0,0>(threaded,inum,ilist,numneigh,firstneigh,acc);
+    }
+  } else if (vflag_global) {
+    if (force->newton_pair) run<0,1,1>(threaded,inum,ilist,numneigh,firstneigh,acc);
+    else run<0,1,0>(threaded,inum,ilist,numneigh,firstneigh,acc);
+  } else {
+    if (force->newton_pair) run<0,0,1>(threaded,inum,ilist,numneigh,firstneigh,acc);
+    else run<0,0,0>(threaded,inum,ilist,numneigh,firstneigh,acc);
+  }
+
+  eng_vdwl += acc[0];
+  eng_coul += acc[1];
+  for (int k = 0; k < 6; k++) virial[k] += acc[2+k];
+}
+
+/* ---------------------------------------------------------------------- */
+
+template <int EFLAG, int VFLAG, int NEWTON_PAIR>
+void PairLJLambda::run(int threaded, int inum, int *ilist, int *numneigh,
+                       int **firstneigh, double *acc)
+{
+  if (threaded) eval_omp<EFLAG,VFLAG,NEWTON_PAIR>(inum,ilist,numneigh,firstneigh,acc);
+  else eval<0,EFLAG,VFLAG,NEWTON_PAIR>(0,inum,ilist,numneigh,firstneigh,atom->f,acc);
+}
+
+/* ----------------------------------------------------------------------
+   threaded force loop balanced by neighbor count: ilist is cut into
+   NCHUNK chunks per thread with equal sums of numneigh (prefix sums),
+   thread t owns a contiguous run of chunks and takes them in order,
+   then steals the remaining chunks of the other threads
+   each thread sums into its own force array, reduced over atoms at the end
+   over the threads the region actually got, which may be fewer than
+   nthreads (OMP_DYNAMIC, nesting, thread limits); chunks are stolen from
+   all nthreads owners, so every chunk is still done
+------------------------------------------------------------------------- */
+
+template <int EFLAG, int VFLAG, int NEWTON_PAIR>
+void PairLJLambda::eval_omp(int inum, int *ilist, int *numneigh,
+                            int **firstneigh, double *acc)
+{
+#if defined(_OPENMP)
+  const int nthreads = omp_get_max_threads();
+  const int nall = atom->nlocal + atom->nghost;
+
+  if (nthreads > nthr || atom->nmax > nmax_thr) {
+    nthr = MAX(nthr,nthreads);
+    nmax_thr = atom->nmax;
+    memory->destroy(fthr);
+    memory->create(fthr,nthr*nmax_thr,3,"pair:fthr");
+  }
+  balance(inum,ilist,numneigh,nthreads);
+
+  double **f = atom->f;
+
+#pragma omp parallel default(shared) num_threads(nthreads)
+  {
+    const int tid = omp_get_thread_num();
+    const int nteam = omp_get_num_threads();
+    double **ft = &fthr[tid*nmax_thr];
+    double a[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+    for (int i = 0; i < nall; i++) ft[i][0] = ft[i][1] = ft[i][2] = 0.0;
+
+    // own chunks first, then the other threads' in ring order
+
+    for (int v = 0; v < nthreads; v++) {
+      const int victim = (tid+v) % nthreads;
+      while (1) {
+        int c;
+#pragma omp atomic capture
+        c = chunk_next[victim]++;
+        if (c >= chunk_end[victim]) break;
+        eval<0,EFLAG,VFLAG,NEWTON_PAIR>(chunk_lo[c],chunk_lo[c+1],ilist,
+                                        numneigh,firstneigh,ft,a);
+      }
+    }
+
+#pragma omp critical
+    for (int k = 0; k < 8; k++) acc[k] += a[k];
+
+#pragma omp barrier
+
+#pragma omp for schedule(static)
+    for (int i = 0; i < nall; i++)
+      for (int t = 0; t < nteam; t++) {
+        f[i][0] += fthr[t*nmax_thr+i][0];
+        f[i][1] += fthr[t*nmax_thr+i][1];
+        f[i][2] += fthr[t*nmax_thr+i][2];
+      }
+  }
+#else
+  eval<0,EFLAG,VFLAG,NEWTON_PAIR>(0,inum,ilist,numneigh,firstneigh,atom->f,acc);
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   chunk boundaries in ilist with equal work, work of i = numneigh + 1,
+   chunks [t*NCHUNK,(t+1)*NCHUNK) are owned by thread t
+------------------------------------------------------------------------- */
+
+void PairLJLambda::balance(int inum, int *ilist, int *numneigh, int nthreads)
+{
+  int nchunk = NCHUNK*nthreads;
+  if (nchunk+1 > maxchunk) {
+    maxchunk = nchunk+1;
+    memory->destroy(chunk_lo);
+    memory->destroy(chunk_next);
+    memory->destroy(chunk_end);
+    memory->create(chunk_lo,maxchunk,"pair:chunk_lo");
+    memory->create(chunk_next,maxchunk,"pair:chunk_next");
+    memory->create(chunk_end,maxchunk,"pair:chunk_end");
+  }
+
+  bigint work = 0;
+  for (int ii = 0; ii < inum; ii++) work += numneigh[ilist[ii]] + 1;
+
+  // walk the prefix sum once, chunk c ends where it passes (c+1)*work/nchunk
+
+  bigint sum = 0;
+  int c = 0;
+  chunk_lo[0] = 0;
+  for (int ii = 0; ii < inum && c < nchunk-1; ii++) {
+    sum += numneigh[ilist[ii]] + 1;
+    while (c < nchunk-1 && sum*nchunk >= (c+1)*work) chunk_lo[++c] = ii+1;
+  }
+  while (c < nchunk) chunk_lo[++c] = inum;
+
+  for (int t = 0; t < nthreads; t++) {
+    chunk_next[t] = t*NCHUNK;
+    chunk_end[t] = (t+1)*NCHUNK;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   time every kernel on the current neighbor list, forces only, and keep
+   the fastest one whose forces match the full-list kernel within
+   KERNELTOL of the largest force; f is restored afterwards
+   the force check only catches summation-order and kernel errors, that
+   the pruned list stays complete as atoms drift is ensured by
+   prune_check() and not measured here
+   the pruned kernels are charged the per-step prune_check() and a prune
+   every prune_every steps plus one per rebuild, taking the shortest
+   possible rebuild interval (neigh_modify every/delay); re-prunes
+   triggered by prune_check() depend on the dynamics and are left out
+   the slowest proc decides, so all procs pick the same kernel
+------------------------------------------------------------------------- */
+
+void PairLJLambda::tune_kernel()
+{
+  if (fixedflag) {
+    kernel = FULL;
+    if (comm->me == 0)
+      utils::logmesg(lmp,"PairLJLambda kernel: full (fixed yes)\n");
+    return;
+  }
+
+  double **f = atom->f;
+  int nall = atom->nlocal + atom->nghost;
+  int inum = list->inum;
+  int *ilist = list->ilist;
+  int newton_pair = force->newton_pair;
+
+  double **fsave,**fref;
+  memory->create(fsave,nall,3,"pair:fsave");
+  memory->create(fref,nall,3,"pair:fref");
+  for (int i = 0; i < nall; i++)
+    for (int k = 0; k < 3; k++) fsave[i][k] = f[i][k];
+
+  // the omp kernels are candidates only with more than one thread
+
+  int ncand = 2;
+#if defined(_OPENMP)
+  if (omp_get_max_threads() > 1) ncand = 4;
+#endif
+  double time[4],timeall[4],err[4],errall[4];
+  double acc[8];
+  double fmax = 0.0;
+
+  for (int m = 0; m < ncand; m++) {
+    int *numneigh = list->numneigh;
+    int **firstneigh = list->firstneigh;
+    double tprune = 0.0;
+    double rebuild = 1.0/MAX(MAX(neighbor->every,neighbor->delay),1);
+    if (m == PRUNE || m == OMP_PRUNE) {
+      double t0 = MPI_Wtime();
+      prune(1);
+      double t1 = MPI_Wtime();
+      volatile int moved = prune_check();     // kept from being optimized out
+      (void) moved;
+      double rate = 1.0/prune_every + rebuild;
+      tprune = (t1-t0)*MIN(rate,1.0) + (MPI_Wtime()-t1);
+      numneigh = inner_numneigh;
+      firstneigh = inner_firstneigh;
+    } else if (idbody) {
+      double t0 = MPI_Wtime();
+      prune(0);
+      tprune = (MPI_Wtime()-t0)*rebuild;
+      numneigh = inner_numneigh;
+      firstneigh = inner_firstneigh;
+    }
+
+    // first call checks the forces, the next NTRIAL are timed
+
+    err[m] = time[m] = 0.0;
+    for (int n = 0; n <= NTRIAL; n++) {
+      for (int i = 0; i < nall; i++)
+        for (int k = 0; k < 3; k++) f[i][k] = 0.0;
+      double t0 = MPI_Wtime();
+      if (newton_pair) run<0,0,1>(m >= OMP,inum,ilist,numneigh,firstneigh,acc);
+      else run<0,0,0>(m >= OMP,inum,ilist,numneigh,firstneigh,acc);
+      if (n > 0) time[m] += MPI_Wtime()-t0;
+      if (n == 0) {
+        for (int i = 0; i < nall; i++)
+          for (int k = 0; k < 3; k++) {
+            if (m == FULL) {
+              fref[i][k] = f[i][k];
+              fmax = MAX(fmax,fabs(f[i][k]));
+            } else err[m] = MAX(err[m],fabs(f[i][k]-fref[i][k]));
+          }
+      }
+    }
+    time[m] = time[m]/NTRIAL + tprune;
+  }
+
+  MPI_Allreduce(time,timeall,ncand,MPI_DOUBLE,MPI_MAX,world);
+  MPI_Allreduce(err,errall,ncand,MPI_DOUBLE,MPI_MAX,world);
+  double fmaxall;
+  MPI_Allreduce(&fmax,&fmaxall,1,MPI_DOUBLE,MPI_MAX,world);
+
+  kernel = FULL;
+  for (int m = 1; m < ncand; m++)
+    if (errall[m] <= KERNELTOL*fmaxall && timeall[m] < timeall[kernel])
+      kernel = m;
+
+  for (int i = 0; i < nall; i++)
+    for (int k = 0; k < 3; k++) f[i][k] = fsave[i][k];
+  memory->destroy(fsave);
+  memory->destroy(fref);
+
+  // the inner list holds what the last candidate needed
+
+  lastprune = -1;
+
+  if (comm->me == 0) {
+    char str[128];
+    utils::logmesg(lmp,"PairLJLambda kernel timings (s/step):");
+    for (int m = 0; m < ncand; m++) {
+      sprintf(str," %s %.4g",kernelnames[m],timeall[m]);
+      utils::logmesg(lmp,str);
+    }
+    sprintf(str,"\nPairLJLambda kernel: %s\n",kernelnames[kernel]);
+    utils::logmesg(lmp,str);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   TALLY = per-atom energy/virial requested, use ev_tally()
+   EFLAG, VFLAG = global energy/virial only, kept in registers
+------------------------------------------------------------------------- */
+
+template <int TALLY, int EFLAG, int VFLAG, int NEWTON_PAIR>
+void PairLJLambda::eval(int iifrom, int iito, int *ilist, int *numneigh,
+                        int **firstneigh, double **f, double *acc)
+{
+  int i,j,ii,jj,jnum,itype,jtype;
   double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,evdwl,ecoul,fpair;
   double rsq,r2inv,r6inv,forcecoul,forcelj,factor_coul,factor_lj;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+  int *jlist;
   double r, rinv, screening;
+  double prefactor,erfc_m,erfc_p,ea,eb;
 
   double TWO_1_3 = pow(2.0,(1.0/3.0)); //JM
+  const double kappa_g = longflag ? 0.5*kappa/g_ewald : 0.0;
+  const double expself = longflag ? exp(-kappa_g*kappa_g) : 0.0;
 
   evdwl = ecoul = 0.0;
-  if (eflag || vflag) ev_setup(eflag,vflag);
-  else evflag = vflag_fdotr = 0;
+  r6inv = rinv = screening = 0.0;
 
   double **x = atom->x;
-  double **f = atom->f;
+  bigint **ff = ffix;
+  int oflow = 0;
   double *q = atom->q;
   int *type = atom->type;
   int nlocal = atom->nlocal;
   double *special_coul = force->special_coul;
   double *special_lj = force->special_lj;
-  int newton_pair = force->newton_pair;
   double qqrd2e = force->qqrd2e;
 
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
+  // energy needed for ev_tally() or the global sums
+
+  const int eflag_pair = TALLY ? eflag_either : EFLAG;
+
+  double evdwl_all = 0.0, ecoul_all = 0.0;
+  double v_all[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
 
   // loop over neighbors of my atoms
 
-  for (ii = 0; ii < inum; ii++) {
+  for (ii = iifrom; ii < iito; ii++) {
     i = ilist[ii];
     qtmp = q[i];
     xtmp = x[i][0];
@@ -102,6 +491,10 @@ void PairLJLambda::compute(int eflag, int vflag)
     jlist = firstneigh[i];
     jnum = numneigh[i];
 
+    double fxtmp = 0.0, fytmp = 0.0, fztmp = 0.0;
+    double evdwl_i = 0.0, ecoul_i = 0.0;
+    double v0 = 0.0, v1 = 0.0, v2 = 0.0, v3 = 0.0, v4 = 0.0, v5 = 0.0;
+
     for (jj = 0; jj < jnum; jj++) {
       j = jlist[jj];
       factor_lj = special_lj[sbmask(j)];
@@ -117,12 +510,34 @@ void PairLJLambda::compute(int eflag, int vflag)
       if (rsq < cutsq[itype][jtype]) {
         r2inv = 1.0/rsq;
 //JM
+        // forcecoul and ecoul include the special bond factor
+
         if (rsq < cut_coulsq[itype][jtype]) {
           r = sqrt(rsq);
           rinv = 1.0/r;
           screening = exp(-kappa*r);
-          forcecoul = qqrd2e * qtmp*q[j] * screening * (kappa + rinv);
-        } else forcecoul = 0.0; //JM
+          prefactor = qqrd2e * qtmp*q[j];
+          if (longflag) {
+
+            // real-space part of the pppm/yukawa split, excluded fraction
+            // of special pairs is removed with the full DH interaction
+
+            erfc_m = erfc(g_ewald*r - kappa_g);
+            erfc_p = erfc(g_ewald*r + kappa_g);
+            ea = screening*erfc_m;
+            eb = erfc_p/screening;
+            forcecoul = prefactor * (0.5*(ea+eb)*rinv + 0.5*kappa*(ea-eb) +
+                                     EWALD_F*g_ewald*expself*exp(-g_ewald*g_ewald*rsq));
+            ecoul = prefactor * 0.5*(ea+eb)*rinv;
+            if (factor_coul < 1.0) {
+              forcecoul -= (1.0-factor_coul) * prefactor*screening*(kappa + rinv);
+              ecoul -= (1.0-factor_coul) * prefactor*screening*rinv;
+            }
+          } else {
+            forcecoul = factor_coul * prefactor * screening * (kappa + rinv);
+            ecoul = factor_coul * prefactor * rinv * screening;
+          }
+        } else forcecoul = ecoul = 0.0; //JM
 //        forcecoul = qqrd2e * qtmp*q[j]*sqrt(r2inv);
 //      else forcecoul = 0.0;
 
@@ -135,21 +550,25 @@ void PairLJLambda::compute(int eflag, int vflag)
             forcelj = lambda[itype][jtype] * r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);	//JM
         } else forcelj = 0.0;
 
-        fpair = (factor_coul*forcecoul + factor_lj*forcelj) * r2inv;
-
-        f[i][0] += delx*fpair;
-        f[i][1] += dely*fpair;
-        f[i][2] += delz*fpair;
-        if (newton_pair || j < nlocal) {
-          f[j][0] -= delx*fpair;
-          f[j][1] -= dely*fpair;
-          f[j][2] -= delz*fpair;
+        fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+
+        if (fixedflag) {
+          FixedPoint::add(ff[i],delx*fpair,dely*fpair,delz*fpair,oflow);
+          if (NEWTON_PAIR || j < nlocal)
+            FixedPoint::sub(ff[j],delx*fpair,dely*fpair,delz*fpair,oflow);
+        } else {
+          fxtmp += delx*fpair;
+          fytmp += dely*fpair;
+          fztmp += delz*fpair;
+          if (NEWTON_PAIR || j < nlocal) {
+            f[j][0] -= delx*fpair;
+            f[j][1] -= dely*fpair;
+            f[j][2] -= delz*fpair;
+          }
         }
 
-        if (eflag) {
-          if (rsq < cut_coulsq[itype][jtype])
-	    ecoul = factor_coul * qqrd2e * qtmp*q[j] * rinv * screening;       //ecoul = factor_coul * qqrd2e * qtmp*q[j]*sqrt(r2inv);
-          else ecoul = 0.0;
+        if (eflag_pair) {
+          //ecoul = factor_coul * qqrd2e * qtmp*q[j]*sqrt(r2inv);
           if (rsq < cut_ljsq[itype][jtype]) {
 //JM
             if (rsq <= TWO_1_3*sigma[itype][jtype]*sigma[itype][jtype])
@@ -161,13 +580,155 @@ void PairLJLambda::compute(int eflag, int vflag)
           } else evdwl = 0.0;
         }
 
-        if (evflag) ev_tally(i,j,nlocal,newton_pair,
-                             evdwl,ecoul,fpair,delx,dely,delz);
+        if (TALLY) ev_tally(i,j,nlocal,NEWTON_PAIR,
+                            evdwl,ecoul,fpair,delx,dely,delz);
+        else if (EFLAG || VFLAG) {
+
+          // same weights as ev_tally(): half for a pair with a ghost j
+          // when newton_pair is off
+
+          const double factor = (NEWTON_PAIR || j < nlocal) ? 1.0 : 0.5;
+          if (EFLAG) {
+            evdwl_i += factor*evdwl;
+            ecoul_i += factor*ecoul;
+          }
+          if (VFLAG) {
+            const double fv = factor*fpair;
+            v0 += delx*delx*fv;
+            v1 += dely*dely*fv;
+            v2 += delz*delz*fv;
+            v3 += delx*dely*fv;
+            v4 += delx*delz*fv;
+            v5 += dely*delz*fv;
+          }
+        }
       }
     }
+
+    f[i][0] += fxtmp;
+    f[i][1] += fytmp;
+    f[i][2] += fztmp;
+
+    if (EFLAG) {
+      evdwl_all += evdwl_i;
+      ecoul_all += ecoul_i;
+    }
+    if (VFLAG) {
+      v_all[0] += v0;
+      v_all[1] += v1;
+      v_all[2] += v2;
+      v_all[3] += v3;
+      v_all[4] += v4;
+      v_all[5] += v5;
+    }
   }
 
-  if (vflag_fdotr) virial_fdotr_compute();
+  if (EFLAG) {
+    acc[0] += evdwl_all;
+    acc[1] += ecoul_all;
+  }
+  if (VFLAG)
+    for (int k = 0; k < 6; k++) acc[2+k] += v_all[k];
+
+  // only set by the serial fixed-point path
+
+  if (oflow) error->one(FLERR,"Force too large for fixed-point summation");
+}
+
+/* ----------------------------------------------------------------------
+   compact the outer (cutoff + skin) list into an inner list of pairs
+   within cutoff + prune_buffer (cutflag = 1) or of all pairs (0),
+   pairs inside one rigid body are left out, special bits are kept
+------------------------------------------------------------------------- */
+
+void PairLJLambda::prune(int cutflag)
+{
+  double **x = atom->x;
+  int *type = atom->type;
+  int *body = idbody ? atom->ivector[ibody] : NULL;
+
+  int inum = list->inum;
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+
+  if (atom->nmax > nmax_prune) {
+    nmax_prune = atom->nmax;
+    memory->destroy(inner_numneigh);
+    memory->sfree(inner_firstneigh);
+    memory->destroy(xprune);
+    memory->create(inner_numneigh,nmax_prune,"pair:inner_numneigh");
+    inner_firstneigh = (int **)
+      memory->smalloc(nmax_prune*sizeof(int *),"pair:inner_firstneigh");
+    memory->create(xprune,nmax_prune,3,"pair:xprune");
+  }
+
+  int nall = atom->nlocal + atom->nghost;
+  for (int i = 0; i < nall; i++) {
+    xprune[i][0] = x[i][0];
+    xprune[i][1] = x[i][1];
+    xprune[i][2] = x[i][2];
+  }
+
+  bigint ntotal = 0;
+  for (int ii = 0; ii < inum; ii++) ntotal += numneigh[ilist[ii]];
+  if (ntotal > MAXSMALLINT)
+    error->one(FLERR,"Too many neighbors for pair ljlambda prune");
+  if (ntotal > maxinner) {
+    maxinner = ntotal;
+    memory->destroy(inner_neigh);
+    memory->create(inner_neigh,maxinner,"pair:inner_neigh");
+  }
+
+  int n = 0;
+  for (int ii = 0; ii < inum; ii++) {
+    int i = ilist[ii];
+    double xtmp = x[i][0];
+    double ytmp = x[i][1];
+    double ztmp = x[i][2];
+    int itype = type[i];
+    int *jlist = firstneigh[i];
+    int jnum = numneigh[i];
+    int *inner = &inner_neigh[n];
+    const int ibody_i = body ? body[i] : 0;
+
+    int m = 0;
+    for (int jj = 0; jj < jnum; jj++) {
+      int j = jlist[jj] & NEIGHMASK;
+      if (ibody_i && body[j] == ibody_i) continue;
+      double delx = xtmp - x[j][0];
+      double dely = ytmp - x[j][1];
+      double delz = ztmp - x[j][2];
+      double rsq = delx*delx + dely*dely + delz*delz;
+      if (!cutflag || rsq < cutprunesq[itype][type[j]]) inner[m++] = jlist[jj];
+    }
+    inner_firstneigh[i] = inner;
+    inner_numneigh[i] = m;
+    n += m;
+  }
+
+  lastprune = update->ntimestep;
+}
+
+/* ----------------------------------------------------------------------
+   1 if an owned or ghost atom moved by more than prune_buffer/2 since
+   the last prune, a pair left out of the inner list can then be within
+   the cutoff; ghosts are checked too, so the decision is local
+------------------------------------------------------------------------- */
+
+int PairLJLambda::prune_check()
+{
+  double **x = atom->x;
+  int nall = atom->nlocal + atom->nghost;
+  double trigger = 0.25*prune_buffer*prune_buffer;
+
+  for (int i = 0; i < nall; i++) {
+    double delx = x[i][0] - xprune[i][0];
+    double dely = x[i][1] - xprune[i][1];
+    double delz = x[i][2] - xprune[i][2];
+    if (delx*delx + dely*dely + delz*delz > trigger) return 1;
+  }
+  return 0;
 }
 
 /* ----------------------------------------------------------------------
@@ -198,21 +759,79 @@ void PairLJLambda::allocate()
   memory->create(lj4,n+1,n+1,"pair:lj4");
   memory->create(offset,n+1,n+1,"pair:offset");
   memory->create(lambda,n+1,n+1,"pair:lambda"); //JM
+  memory->create(typecount,n+1,"pair:typecount");
+  memory->create(typeqmax,n+1,"pair:typeqmax");
+  memory->create(cutprunesq,n+1,n+1,"pair:cutprunesq");
 }
 
 /* ----------------------------------------------------------------------
    global settings
+   pair_style ljlambda kappa cut_lj [cut_coul] keyword value ...
+     fixed yes/no = deterministic fixed-point force summation
+     prune N buffer = kernel runs over pairs within cutoff + buffer,
+                      re-pruned every N steps, after each rebuild and
+                      once an atom moved by buffer/2
+     kernel full/prune/omp/omp/prune/auto = force loop over the neighbor
+       list or the pruned list, serial or threaded, or the fastest of them
+     rigid i_name = exclude pairs with the same nonzero body ID i_name
 ------------------------------------------------------------------------- */
 
 void PairLJLambda::settings(int narg, char **arg)
 {
-  if (narg < 2 || narg > 3) error->all(FLERR,"Illegal pair_style command");
-  
+  int nnum = 0;
+  while (nnum < narg && nnum < 3 && utils::is_double(arg[nnum])) nnum++;
+  if (nnum < 2) error->all(FLERR,"Illegal pair_style command");
+
   kappa = utils::numeric(FLERR,arg[0],false,lmp);
   cut_lj_global = utils::numeric(FLERR,arg[1],false,lmp);
-  if (narg == 1) cut_coul_global = cut_lj_global;
+  if (nnum == 2) cut_coul_global = cut_lj_global;
   else cut_coul_global = utils::numeric(FLERR,arg[2],false,lmp);
 
+  fixedflag = 0;
+  kernelflag = -1;
+  prune_every = 4;
+  prune_buffer = 1.0;
+  int pruneset = 0;
+  delete [] idbody;
+  idbody = NULL;
+
+  int iarg = nnum;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"fixed") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_style command");
+      if (strcmp(arg[iarg+1],"yes") == 0) fixedflag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) fixedflag = 0;
+      else error->all(FLERR,"Illegal pair_style command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"prune") == 0) {
+      if (iarg+3 > narg) error->all(FLERR,"Illegal pair_style command");
+      prune_every = utils::inumeric(FLERR,arg[iarg+1],false,lmp);
+      prune_buffer = utils::numeric(FLERR,arg[iarg+2],false,lmp);
+      if (prune_every < 1 || prune_buffer < 0.0)
+        error->all(FLERR,"Illegal pair_style command");
+      pruneset = 1;
+      iarg += 3;
+    } else if (strcmp(arg[iarg],"kernel") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_style command");
+      if (strcmp(arg[iarg+1],"full") == 0) kernelflag = FULL;
+      else if (strcmp(arg[iarg+1],"prune") == 0) kernelflag = PRUNE;
+      else if (strcmp(arg[iarg+1],"omp") == 0) kernelflag = OMP;
+      else if (strcmp(arg[iarg+1],"omp/prune") == 0) kernelflag = OMP_PRUNE;
+      else if (strcmp(arg[iarg+1],"auto") == 0) kernelflag = AUTO;
+      else error->all(FLERR,"Illegal pair_style command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"rigid") == 0) {
+      if (iarg+2 > narg || strncmp(arg[iarg+1],"i_",2) != 0)
+        error->all(FLERR,"Illegal pair_style command");
+      delete [] idbody;
+      idbody = new char[strlen(arg[iarg+1])-1];
+      strcpy(idbody,&arg[iarg+1][2]);
+      iarg += 2;
+    } else error->all(FLERR,"Illegal pair_style command");
+  }
+
+  if (kernelflag < 0) kernelflag = pruneset ? PRUNE : FULL;
+
   // reset cutoffs that have been explicitly set
 
   if (allocated) {
@@ -274,7 +893,58 @@ void PairLJLambda::init_style()
   if (!atom->q_flag)
     error->all(FLERR,"Pair style ljlambda requires atom attribute q");
 
+  // with kspace_style pppm/yukawa only the erfc-split real-space part of
+  // Debye-Hueckel is computed here, up to the global coulomb cutoff
+
+  longflag = 0;
+  if (force->kspace) {
+    if (force->kspace_match("pppm/yukawa",0) == NULL)
+      error->all(FLERR,"Pair style ljlambda requires kspace_style pppm/yukawa");
+    longflag = 1;
+    g_ewald = force->kspace->g_ewald;
+  }
+
   neighbor->request(this,instance_me);
+
+  if ((kernelflag == PRUNE || kernelflag == OMP_PRUNE || kernelflag == AUTO) &&
+      prune_buffer > neighbor->skin && comm->me == 0)
+    error->warning(FLERR,"Pair ljlambda prune buffer is larger than the "
+                   "neighbor skin");
+  lastprune = -1;
+  kernel = (kernelflag == AUTO) ? -1 : kernelflag;
+
+  if (idbody)
+    ibody = RigidBody::find(atom,modify,error,idbody,"pair_style ljlambda");
+
+  // types that carry no charge on any proc get no DH cutoff in init_one()
+
+  {
+    double *q = atom->q;
+    int *type = atom->type;
+    int nlocal = atom->nlocal;
+    int ntypes = atom->ntypes;
+
+    double *qmax = new double[ntypes+1];
+    for (int k = 0; k <= ntypes; k++) qmax[k] = 0.0;
+    for (int k = 0; k < nlocal; k++) qmax[type[k]] = MAX(qmax[type[k]],fabs(q[k]));
+    MPI_Allreduce(qmax,typeqmax,ntypes+1,MPI_DOUBLE,MPI_MAX,world);
+    delete [] qmax;
+  }
+
+  // count atoms of each type once, shared by all init_one() tail terms
+  // instead of one scan + Allreduce per type pair
+
+  if (tail_flag) {
+    int *type = atom->type;
+    int nlocal = atom->nlocal;
+    int ntypes = atom->ntypes;
+
+    double *count = new double[ntypes+1];
+    for (int k = 0; k <= ntypes; k++) count[k] = 0.0;
+    for (int k = 0; k < nlocal; k++) count[type[k]] += 1.0;
+    MPI_Allreduce(count,typecount,ntypes+1,MPI_DOUBLE,MPI_SUM,world);
+    delete [] count;
+  }
 }
 
 /* ----------------------------------------------------------------------
@@ -291,9 +961,20 @@ double PairLJLambda::init_one(int i, int j)
     cut_coul[i][j] = mix_distance(cut_coul[i][i],cut_coul[j][j]);
   }
 
-  double cut = MAX(cut_lj[i][j],cut_coul[i][j]);
+  // a pair with a neutral type has no DH term, dropping its coulomb cutoff
+  // shortens the per-type ghost cutoff of comm_modify mode multi from
+  // cut_coul+skin to cut_lj+skin for most residue types
+  // with kspace every charged pair (cut_coul > 0) uses the global cutoff,
+  // the real-space part must be cut at the same distance for all pairs
+
+  double cut_coul_ij = cut_coul[i][j];
+  if (typeqmax[i] == 0.0 || typeqmax[j] == 0.0) cut_coul_ij = 0.0;
+  if (longflag && cut_coul_ij > 0.0) cut_coul_ij = cut_coul_global;
+
+  double cut = MAX(cut_lj[i][j],cut_coul_ij);
   cut_ljsq[i][j] = cut_lj[i][j] * cut_lj[i][j];
-  cut_coulsq[i][j] = cut_coul[i][j] * cut_coul[i][j];
+  cut_coulsq[i][j] = cut_coul_ij * cut_coul_ij;
+  cutprunesq[i][j] = (cut+prune_buffer) * (cut+prune_buffer);
 
   lj1[i][j] = 48.0 * epsilon[i][j] * pow(sigma[i][j],12.0);
   lj2[i][j] = 24.0 * epsilon[i][j] * pow(sigma[i][j],6.0);
@@ -307,6 +988,7 @@ double PairLJLambda::init_one(int i, int j)
 
   cut_ljsq[j][i] = cut_ljsq[i][j];
   cut_coulsq[j][i] = cut_coulsq[i][j];
+  cutprunesq[j][i] = cutprunesq[i][j];
   lj1[j][i] = lj1[i][j];
   lj2[j][i] = lj2[i][j];
   lj3[j][i] = lj3[i][j];
@@ -317,19 +999,12 @@ double PairLJLambda::init_one(int i, int j)
   offset[j][i] = offset[i][j];
 
   // compute I,J contribution to long-range tail correction
-  // count total # of atoms of type I and J via Allreduce
+  // total # of atoms of type I and J was counted in init_style()
 
   if (tail_flag) {
-    int *type = atom->type;
-    int nlocal = atom->nlocal;
-
-    double count[2],all[2];
-    count[0] = count[1] = 0.0;
-    for (int k = 0; k < nlocal; k++) {
-      if (type[k] == i) count[0] += 1.0;
-      if (type[k] == j) count[1] += 1.0;
-    }
-    MPI_Allreduce(count,all,2,MPI_DOUBLE,MPI_SUM,world);
+    double all[2];
+    all[0] = typecount[i];
+    all[1] = typecount[j];
 
     double sig2 = sigma[i][j]*sigma[i][j];
     double sig6 = sig2*sig2*sig2;
@@ -411,6 +1086,8 @@ void PairLJLambda::write_restart_settings(FILE *fp)
   fwrite(&offset_flag,sizeof(int),1,fp);
   fwrite(&mix_flag,sizeof(int),1,fp);
   fwrite(&tail_flag,sizeof(int),1,fp);
+  fwrite(&fixedflag,sizeof(int),1,fp);
+  RigidBody::write(fp,idbody);
 }
 
 /* ----------------------------------------------------------------------
@@ -426,6 +1103,7 @@ void PairLJLambda::read_restart_settings(FILE *fp)
     utils::sfread(FLERR,&offset_flag,sizeof(int),1,fp,NULL,error);
     utils::sfread(FLERR,&mix_flag,sizeof(int),1,fp,NULL,error);
     utils::sfread(FLERR,&tail_flag,sizeof(int),1,fp,NULL,error);
+    utils::sfread(FLERR,&fixedflag,sizeof(int),1,fp,NULL,error);
   }
   MPI_Bcast(&cut_lj_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&cut_coul_global,1,MPI_DOUBLE,0,world);
@@ -433,6 +1111,8 @@ void PairLJLambda::read_restart_settings(FILE *fp)
   MPI_Bcast(&offset_flag,1,MPI_INT,0,world);
   MPI_Bcast(&mix_flag,1,MPI_INT,0,world);
   MPI_Bcast(&tail_flag,1,MPI_INT,0,world);
+  MPI_Bcast(&fixedflag,1,MPI_INT,0,world);
+  RigidBody::read(fp,idbody,comm->me,world,error);
 }
 
 /* ----------------------------------------------------------------------
@@ -468,12 +1148,36 @@ double PairLJLambda::single(int i, int j, int itype, int jtype,
 
   double TWO_1_3 = pow(2.0,(1.0/3.0));
 
+  if (idbody) {
+    int *body = atom->ivector[ibody];
+    if (body[i] && body[i] == body[j]) {
+      fforce = 0.0;
+      return 0.0;
+    }
+  }
+
   r2inv = 1.0/rsq;
+  phicoul = 0.0;
   if (rsq < cut_coulsq[itype][jtype]) {
     r = sqrt(rsq);
     rinv = 1.0/r;
     screening = exp(-kappa*r);
-    forcecoul = force->qqrd2e * atom->q[i]*atom->q[j] * screening * (kappa + rinv);
+    double prefactor = force->qqrd2e * atom->q[i]*atom->q[j];
+    if (longflag) {
+      double kappa_g = 0.5*kappa/g_ewald;
+      double ea = screening*erfc(g_ewald*r - kappa_g);
+      double eb = erfc(g_ewald*r + kappa_g)/screening;
+      forcecoul = prefactor * (0.5*(ea+eb)*rinv + 0.5*kappa*(ea-eb) +
+                               EWALD_F*g_ewald*exp(-kappa_g*kappa_g - g_ewald*g_ewald*rsq));
+      phicoul = prefactor * 0.5*(ea+eb)*rinv;
+      if (factor_coul < 1.0) {
+        forcecoul -= (1.0-factor_coul) * prefactor*screening*(kappa + rinv);
+        phicoul -= (1.0-factor_coul) * prefactor*screening*rinv;
+      }
+    } else {
+      forcecoul = factor_coul * prefactor * screening * (kappa + rinv);
+      phicoul = factor_coul * prefactor * rinv * screening;
+    }
   } else forcecoul = 0.0;
 //    forcecoul = force->qqrd2e * atom->q[i]*atom->q[j]*sqrt(r2inv);
 //  else forcecoul = 0.0;
@@ -487,13 +1191,9 @@ double PairLJLambda::single(int i, int j, int itype, int jtype,
 //forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
 //} else forcelj = 0.0;
 
-  fforce = (factor_coul*forcecoul + factor_lj*forcelj) * r2inv;
+  fforce = (forcecoul + factor_lj*forcelj) * r2inv;
 
-  double eng = 0.0;
-  if (rsq < cut_coulsq[itype][jtype]) {
-    phicoul = force->qqrd2e * atom->q[i]*atom->q[j] * rinv * screening; //phicoul = force->qqrd2e * atom->q[i]*atom->q[j]*sqrt(r2inv);
-    eng += factor_coul*phicoul;
-  }
+  double eng = phicoul; //phicoul = force->qqrd2e * atom->q[i]*atom->q[j]*sqrt(r2inv);
   if (rsq < cut_ljsq[itype][jtype]) {
     if (rsq <= TWO_1_3*sigma[itype][jtype]*sigma[itype][jtype])
       philj = r6inv*(lj3[itype][jtype]*r6inv-lj4[itype][jtype]) + (1-lambda[itype][jtype])*epsilon[itype][jtype];
@@ -512,7 +1212,8 @@ double PairLJLambda::single(int i, int j, int itype, int jtype,
 void *PairLJLambda::extract(const char *str, int &dim)
 {
   dim = 0;
-  if (strcmp(str,"cut_coul") == 0) return (void *) &cut_coul;
+  if (strcmp(str,"cut_coul") == 0) return (void *) &cut_coul_global;
+  if (strcmp(str,"kappa") == 0) return (void *) &kappa;
   dim = 2;
   if (strcmp(str,"epsilon") == 0) return (void *) epsilon;
   if (strcmp(str,"sigma") == 0) return (void *) sigma;
@@ -0,0 +1,166 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cstdio>
+#include <cstring>
+#include "neigh_tune.h"
+#include "domain.h"
+#include "neighbor.h"
+#include "input.h"
+#include "timer.h"
+#include "comm.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+
+#define MAXTRIAL 64
+
+enum{NSQ,BIN,MULTI};    // same as Neighbor::style
+
+/* ---------------------------------------------------------------------- */
+
+NeighTune::NeighTune(LAMMPS *lmp) : Pointers(lmp) {}
+
+/* ----------------------------------------------------------------------
+   neigh_tune N skin s1 s2 ... every e1 e2 ...
+     N = steps per trial run, trials continue the trajectory
+     every all combinations of skin and every are run with delay 0 check yes
+   the setting with the smallest Pair+Neigh+Comm time and no dangerous
+   builds is kept for the following runs
+------------------------------------------------------------------------- */
+
+void NeighTune::command(int narg, char **arg)
+{
+  if (domain->box_exist == 0)
+    error->all(FLERR,"Neigh_tune command before simulation box is defined");
+  if (narg < 5) error->all(FLERR,"Illegal neigh_tune command");
+
+  bigint nsteps = utils::bnumeric(FLERR,arg[0],false,lmp);
+  if (nsteps <= 0) error->all(FLERR,"Illegal neigh_tune command");
+
+  double skins[MAXTRIAL];
+  int everys[MAXTRIAL];
+  int nskin = 0, nevery = 0;
+
+  int iarg = 1;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"skin") == 0) {
+      iarg++;
+      while (iarg < narg && strcmp(arg[iarg],"every") != 0) {
+        if (nskin == MAXTRIAL) error->all(FLERR,"Illegal neigh_tune command");
+        skins[nskin] = utils::numeric(FLERR,arg[iarg],false,lmp);
+        if (skins[nskin] < 0.0) error->all(FLERR,"Illegal neigh_tune command");
+        nskin++;
+        iarg++;
+      }
+    } else if (strcmp(arg[iarg],"every") == 0) {
+      iarg++;
+      while (iarg < narg && strcmp(arg[iarg],"skin") != 0) {
+        if (nevery == MAXTRIAL) error->all(FLERR,"Illegal neigh_tune command");
+        everys[nevery] = utils::inumeric(FLERR,arg[iarg],false,lmp);
+        if (everys[nevery] <= 0) error->all(FLERR,"Illegal neigh_tune command");
+        nevery++;
+        iarg++;
+      }
+    } else error->all(FLERR,"Illegal neigh_tune command");
+  }
+  if (nskin == 0 || nevery == 0)
+    error->all(FLERR,"Neigh_tune needs at least one skin and one every value");
+
+  double skin_orig = neighbor->skin;
+  int every_orig = neighbor->every;
+
+  char str[128];
+  if (comm->me == 0) {
+    sprintf(str,"Neigh_tune: %d trials of " BIGINT_FORMAT " steps\n"
+            "  skin every time/step(s) dangerous\n",nskin*nevery,nsteps);
+    utils::logmesg(lmp,str);
+  }
+
+  double tbest = -1.0;
+  double skin_best = skin_orig;
+  int every_best = every_orig;
+  bigint ndanger;
+
+  for (int i = 0; i < nskin; i++)
+    for (int j = 0; j < nevery; j++) {
+      double t = trial(skins[i],everys[j],nsteps,ndanger) / nsteps;
+      if (comm->me == 0) {
+        sprintf(str,"  %g %d %.6g " BIGINT_FORMAT "\n",
+                skins[i],everys[j],t,ndanger);
+        utils::logmesg(lmp,str);
+      }
+      if (ndanger) continue;
+      if (tbest < 0.0 || t < tbest) {
+        tbest = t;
+        skin_best = skins[i];
+        every_best = everys[j];
+      }
+    }
+
+  if (tbest < 0.0) {
+    if (comm->me == 0)
+      error->warning(FLERR,"All neigh_tune trials had dangerous builds, "
+                     "keeping the original settings");
+    apply(skin_orig,every_orig);
+    return;
+  }
+
+  apply(skin_best,every_best);
+  if (comm->me == 0) {
+    sprintf(str,"Neigh_tune: using skin %g every %d delay 0\n",
+            skin_best,every_best);
+    utils::logmesg(lmp,str);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   run one trial, return max over procs of Pair+Neigh+Comm wall time
+------------------------------------------------------------------------- */
+
+double NeighTune::trial(double skin, int every, bigint nsteps, bigint &ndanger)
+{
+  apply(skin,every);
+  neighbor->ndanger = 0;
+
+  char str[64];
+  sprintf(str,"run " BIGINT_FORMAT " post no",nsteps);
+  input->one(str);
+
+  double one = timer->get_wall(Timer::PAIR) + timer->get_wall(Timer::NEIGH) +
+    timer->get_wall(Timer::COMM);
+  double all;
+  MPI_Allreduce(&one,&all,1,MPI_DOUBLE,MPI_MAX,world);
+
+  ndanger = neighbor->ndanger;
+  return all;
+}
+
+/* ----------------------------------------------------------------------
+   keep the neighbor style (bin/nsq/multi), only change skin and every
+------------------------------------------------------------------------- */
+
+void NeighTune::apply(double skin, int every)
+{
+  const char *style;
+  if (neighbor->style == NSQ) style = "nsq";
+  else if (neighbor->style == MULTI) style = "multi";
+  else style = "bin";
+
+  char str[64];
+  sprintf(str,"neighbor %.10g %s",skin,style);
+  input->one(str);
+  sprintf(str,"neigh_modify every %d delay 0 check yes",every);
+  input->one(str);
+}
@@ -0,0 +1,65 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Short trial runs over neighbor skin / rebuild interval, keeps the fastest
+   setting that had no dangerous builds
+------------------------------------------------------------------------- */
+
+#ifdef COMMAND_CLASS
+
+CommandStyle(neigh_tune,NeighTune)
+
+#else
+
+#ifndef LMP_NEIGH_TUNE_H
+#define LMP_NEIGH_TUNE_H
+
+#include "pointers.h"
+
+namespace LAMMPS_NS {
+
+class NeighTune : protected Pointers {
+ public:
+  NeighTune(class LAMMPS *);
+  void command(int, char **);
+
+ private:
+  double trial(double, int, bigint, bigint &);
+  void apply(double, int);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Neigh_tune command before simulation box is defined
+
+Self-explanatory.
+
+E: Neigh_tune needs at least one skin and one every value
+
+Self-explanatory.
+
+W: All neigh_tune trials had dangerous builds, keeping the original settings
+
+None of the tested skin/every combinations was safe.  Test larger skins
+or smaller rebuild intervals.
+
+*/
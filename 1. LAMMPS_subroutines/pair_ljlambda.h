@@ -21,6 +21,7 @@ PairStyle(ljlambda,PairLJLambda)
 #ifndef LMP_PAIR_LJLAMBDA_H
 #define LMP_PAIR_LJLAMBDA_H
 
+#include <cmath>
 #include "pair.h"
 
 namespace LAMMPS_NS {
@@ -43,6 +44,28 @@ class PairLJLambda : public Pair {
   virtual double single(int, int, int, int, double, double, double, double &);
   void *extract(const char *, int &);
 
+  // energy of one i,j pair with plain DH screening and no special factor,
+  // prefactor = qqrd2e*qi*qj; inlined into the insertion loops of widom/chain
+
+  inline double single_energy(int itype, int jtype, double prefactor,
+                              double rsq) const
+  {
+    double eng = 0.0;
+    if (rsq < cut_coulsq[itype][jtype]) {
+      double r = sqrt(rsq);
+      eng = prefactor * exp(-kappa*r) / r;
+    }
+    if (rsq < cut_ljsq[itype][jtype]) {
+      double r2inv = 1.0/rsq;
+      double r6inv = r2inv*r2inv*r2inv;
+      double philj = r6inv*(lj3[itype][jtype]*r6inv - lj4[itype][jtype]);
+      if (rsq <= 1.2599210498948732*sigma[itype][jtype]*sigma[itype][jtype])
+        eng += philj + (1.0-lambda[itype][jtype])*epsilon[itype][jtype];
+      else eng += lambda[itype][jtype]*philj - offset[itype][jtype];
+    }
+    return eng;
+  }
+
  protected:
   double cut_lj_global,cut_coul_global;
   double **cut_lj,**cut_ljsq;
@@ -51,8 +74,48 @@ class PairLJLambda : public Pair {
   double **lj1,**lj2,**lj3,**lj4,**offset;
   double **lambda; //JM
   double kappa; //JM
+  int longflag;                // 1 = real-space part of pppm/yukawa
+  double g_ewald;
+  double *typecount;           // # of atoms of each type, for tail terms
+  double *typeqmax;            // largest |q| of each type, 0 = neutral
+
+  int fixedflag;               // 1 = deterministic fixed-point forces
+  bigint **ffix;
+  int nmax_fix;
+
+  char *idbody;                // i_name of the rigid body ID, NULL = none
+  int ibody;
+
+  int kernelflag;              // FULL, PRUNE, OMP, OMP_PRUNE or AUTO
+  int kernel;                  // kernel in use, -1 = AUTO not tuned yet
+  int prune_every;
+  double prune_buffer;
+  double **cutprunesq;
+  int *inner_numneigh;         // inner list, indexed like the outer list
+  int **inner_firstneigh;
+  int *inner_neigh;
+  double **xprune;             // positions at the last prune
+  int nmax_prune;
+  bigint maxinner,lastprune;
+  double **fthr;               // per-thread forces of the omp kernels
+  int nmax_thr,nthr;
+  int *chunk_lo;               // first ilist index of each chunk
+  int *chunk_next,*chunk_end;  // next and end chunk of each thread
+  int maxchunk;
 
   void allocate();
+  void prune(int);
+  int prune_check();
+  void dispatch(int, int *, int *, int **);
+  void tune_kernel();
+  void balance(int, int *, int *, int);
+
+  template <int TALLY, int EFLAG, int VFLAG, int NEWTON_PAIR>
+  void eval(int, int, int *, int *, int **, double **, double *);
+  template <int EFLAG, int VFLAG, int NEWTON_PAIR>
+  void run(int, int, int *, int *, int **, double *);
+  template <int EFLAG, int VFLAG, int NEWTON_PAIR>
+  void eval_omp(int, int *, int *, int **, double *);
 };
 
 }
@@ -76,4 +139,32 @@ E: Pair style ljlambda requires atom attribute q
 
 The atom style defined does not have this attribute.
 
+E: Pair style ljlambda requires kspace_style pppm/yukawa
+
+Only the screened-Coulomb solver has a matching real-space split.
+
+W: Pair ljlambda prune buffer is larger than the neighbor skin
+
+The inner list cannot hold pairs beyond the outer list cutoff, pruning
+then only removes the cost of the skin.
+
+E: Too many neighbors for pair ljlambda prune
+
+The inner list of one proc is limited to 2^31 entries.
+
+E: Rigid body property for pair_style ljlambda does not exist
+
+The rigid keyword needs an integer per-atom property, e.g. defined by
+fix property/atom i_body ghost yes.
+
+E: Rigid body property for pair_style ljlambda needs fix property/atom ghost yes
+
+Body IDs of ghost atoms are used, so the property must be defined by
+a fix property/atom with ghost yes.
+
+E: Force too large for fixed-point summation
+
+With fixed yes a single force component must stay below 2^20
+kcal/mol/Angstrom (or is NaN).  Minimize first or use fixed no.
+
 */
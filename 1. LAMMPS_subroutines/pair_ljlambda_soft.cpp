@@ -0,0 +1,556 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include "pair_ljlambda_soft.h"
+#include "math.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "atom.h"
+#include "comm.h"
+#include "force.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "memory.h"
+#include "error.h"
+#include "utils.h"
+
+using namespace LAMMPS_NS;
+
+/* ----------------------------------------------------------------------
+   with s = alpha_lj (1-l_lj)^2 + (r/sigma)^6 and d = sqrt(alpha_c (1-l_c)^2 + r^2)
+     E_lj   = l_lj^n [4 eps (1/s^2 - 1/s) + (1-lambda) eps]      s <= 2
+            = l_lj^n [lambda 4 eps (1/s^2 - 1/s) - offset]       s > 2
+     E_coul = l_c^n qqrd2e qi qj exp(-kappa d)/d
+   l_lj = l_c = 1 is ljlambda; s = 2 is r = 2^(1/6) sigma at l_lj = 1
+------------------------------------------------------------------------- */
+
+PairLJLambdaSoft::PairLJLambdaSoft(LAMMPS *lmp) : Pair(lmp)
+{
+  writedata = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairLJLambdaSoft::~PairLJLambdaSoft()
+{
+  if (allocated) {
+    memory->destroy(setflag);
+    memory->destroy(cutsq);
+
+    memory->destroy(cut_lj);
+    memory->destroy(cut_ljsq);
+    memory->destroy(cut_coul);
+    memory->destroy(cut_coulsq);
+    memory->destroy(epsilon);
+    memory->destroy(sigma);
+    memory->destroy(lambda);
+    memory->destroy(lambda_lj);
+    memory->destroy(lambda_coul);
+    memory->destroy(lj1);
+    memory->destroy(lj2);
+    memory->destroy(lj3);
+    memory->destroy(lj4);
+    memory->destroy(offset);
+    memory->destroy(coul1);
+    memory->destroy(coul2);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::compute(int eflag, int vflag)
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,evdwl,ecoul,fpair;
+  double rsq,forcecoul,forcelj,factor_coul,factor_lj;
+  double denc,screening,denlj,u,s6;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  evdwl = ecoul = 0.0;
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+
+  inum = list->inum;
+  ilist = list->ilist;
+  numneigh = list->numneigh;
+  firstneigh = list->firstneigh;
+
+  // loop over neighbors of my atoms
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qtmp = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+
+      if (rsq < cutsq[itype][jtype]) {
+
+        // forcecoul and forcelj are already divided by r
+
+        if (rsq < cut_coulsq[itype][jtype]) {
+          denc = sqrt(coul2[itype][jtype] + rsq);
+          screening = exp(-kappa*denc);
+          forcecoul = qqrd2e * coul1[itype][jtype] * qtmp*q[j] *
+            screening * (kappa + 1.0/denc) / (denc*denc);
+        } else forcecoul = 0.0;
+
+        if (rsq < cut_ljsq[itype][jtype]) {
+          s6 = rsq*rsq*rsq / lj2[itype][jtype];
+          denlj = lj3[itype][jtype] + s6;
+          u = 1.0/denlj;
+          forcelj = lj1[itype][jtype] * lj4[itype][jtype] *
+            (2.0*u*u*u - u*u) * 6.0*s6/rsq;
+          if (denlj > 2.0) forcelj *= lambda[itype][jtype];
+        } else forcelj = 0.0;
+
+        fpair = factor_coul*forcecoul + factor_lj*forcelj;
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+
+        if (eflag) {
+          if (rsq < cut_coulsq[itype][jtype])
+            ecoul = factor_coul * qqrd2e * coul1[itype][jtype] * qtmp*q[j] *
+              screening / denc;
+          else ecoul = 0.0;
+          if (rsq < cut_ljsq[itype][jtype]) {
+            if (denlj <= 2.0)
+              evdwl = lj1[itype][jtype] * (lj4[itype][jtype]*(u*u - u) +
+                (1.0-lambda[itype][jtype])*epsilon[itype][jtype]);
+            else
+              evdwl = lj1[itype][jtype] * (lambda[itype][jtype] *
+                lj4[itype][jtype]*(u*u - u) - offset[itype][jtype]);
+            evdwl *= factor_lj;
+          } else evdwl = 0.0;
+        }
+
+        if (evflag) ev_tally(i,j,nlocal,newton_pair,
+                             evdwl,ecoul,fpair,delx,dely,delz);
+      }
+    }
+  }
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   allocate all arrays
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::allocate()
+{
+  allocated = 1;
+  int n = atom->ntypes;
+
+  memory->create(setflag,n+1,n+1,"pair:setflag");
+  for (int i = 1; i <= n; i++)
+    for (int j = i; j <= n; j++)
+      setflag[i][j] = 0;
+
+  memory->create(cutsq,n+1,n+1,"pair:cutsq");
+
+  memory->create(cut_lj,n+1,n+1,"pair:cut_lj");
+  memory->create(cut_ljsq,n+1,n+1,"pair:cut_ljsq");
+  memory->create(cut_coul,n+1,n+1,"pair:cut_coul");
+  memory->create(cut_coulsq,n+1,n+1,"pair:cut_coulsq");
+  memory->create(epsilon,n+1,n+1,"pair:epsilon");
+  memory->create(sigma,n+1,n+1,"pair:sigma");
+  memory->create(lambda,n+1,n+1,"pair:lambda");
+  memory->create(lambda_lj,n+1,n+1,"pair:lambda_lj");
+  memory->create(lambda_coul,n+1,n+1,"pair:lambda_coul");
+  memory->create(lj1,n+1,n+1,"pair:lj1");
+  memory->create(lj2,n+1,n+1,"pair:lj2");
+  memory->create(lj3,n+1,n+1,"pair:lj3");
+  memory->create(lj4,n+1,n+1,"pair:lj4");
+  memory->create(offset,n+1,n+1,"pair:offset");
+  memory->create(coul1,n+1,n+1,"pair:coul1");
+  memory->create(coul2,n+1,n+1,"pair:coul2");
+}
+
+/* ----------------------------------------------------------------------
+   global settings
+   pair_style ljlambda/soft n alpha_lj alpha_coul kappa cut_lj [cut_coul]
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::settings(int narg, char **arg)
+{
+  if (narg < 5 || narg > 6) error->all(FLERR,"Illegal pair_style command");
+
+  nlambda = utils::numeric(FLERR,arg[0],false,lmp);
+  alphalj = utils::numeric(FLERR,arg[1],false,lmp);
+  alphac = utils::numeric(FLERR,arg[2],false,lmp);
+  kappa = utils::numeric(FLERR,arg[3],false,lmp);
+  cut_lj_global = utils::numeric(FLERR,arg[4],false,lmp);
+  if (narg == 5) cut_coul_global = cut_lj_global;
+  else cut_coul_global = utils::numeric(FLERR,arg[5],false,lmp);
+  if (nlambda < 0.0 || alphalj < 0.0 || alphac < 0.0)
+    error->all(FLERR,"Illegal pair_style command");
+
+  // reset cutoffs that have been explicitly set
+
+  if (allocated) {
+    int i,j;
+    for (i = 1; i <= atom->ntypes; i++)
+      for (j = i+1; j <= atom->ntypes; j++)
+        if (setflag[i][j]) {
+          cut_lj[i][j] = cut_lj_global;
+          cut_coul[i][j] = cut_coul_global;
+        }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   set coeffs for one or more type pairs
+   pair_coeff I J epsilon sigma lambda lambda_lj lambda_coul [cut_lj [cut_coul]]
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::coeff(int narg, char **arg)
+{
+  if (narg < 7 || narg > 9)
+    error->all(FLERR,"Incorrect args for pair coefficients");
+  if (!allocated) allocate();
+
+  int ilo,ihi,jlo,jhi;
+  utils::bounds(FLERR,arg[0],1,atom->ntypes,ilo,ihi,error);
+  utils::bounds(FLERR,arg[1],1,atom->ntypes,jlo,jhi,error);
+
+  double epsilon_one = utils::numeric(FLERR,arg[2],false,lmp);
+  double sigma_one = utils::numeric(FLERR,arg[3],false,lmp);
+  double lambda_one = utils::numeric(FLERR,arg[4],false,lmp);
+  double lambda_lj_one = utils::numeric(FLERR,arg[5],false,lmp);
+  double lambda_coul_one = utils::numeric(FLERR,arg[6],false,lmp);
+  if (lambda_lj_one < 0.0 || lambda_lj_one > 1.0 ||
+      lambda_coul_one < 0.0 || lambda_coul_one > 1.0)
+    error->all(FLERR,"Incorrect args for pair coefficients");
+
+  double cut_lj_one = cut_lj_global;
+  double cut_coul_one = cut_coul_global;
+  if (narg >= 8) cut_coul_one = cut_lj_one = utils::numeric(FLERR,arg[7],false,lmp);
+  if (narg == 9) cut_coul_one = utils::numeric(FLERR,arg[8],false,lmp);
+
+  int count = 0;
+  for (int i = ilo; i <= ihi; i++) {
+    for (int j = MAX(jlo,i); j <= jhi; j++) {
+      epsilon[i][j] = epsilon_one;
+      sigma[i][j] = sigma_one;
+      lambda[i][j] = lambda_one;
+      lambda_lj[i][j] = lambda_lj_one;
+      lambda_coul[i][j] = lambda_coul_one;
+      cut_lj[i][j] = cut_lj_one;
+      cut_coul[i][j] = cut_coul_one;
+      setflag[i][j] = 1;
+      count++;
+    }
+  }
+
+  if (count == 0) error->all(FLERR,"Incorrect args for pair coefficients");
+}
+
+/* ----------------------------------------------------------------------
+   init specific to this pair style
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::init_style()
+{
+  if (!atom->q_flag)
+    error->all(FLERR,"Pair style ljlambda/soft requires atom attribute q");
+  if (force->kspace)
+    error->all(FLERR,"Pair style ljlambda/soft does not support kspace");
+
+  neighbor->request(this,instance_me);
+}
+
+/* ----------------------------------------------------------------------
+   init for one type pair i,j and corresponding j,i
+   also called by fix adapt and compute fep after a coupling change
+------------------------------------------------------------------------- */
+
+double PairLJLambdaSoft::init_one(int i, int j)
+{
+  if (setflag[i][j] == 0) {
+    epsilon[i][j] = mix_energy(epsilon[i][i],epsilon[j][j],
+                               sigma[i][i],sigma[j][j]);
+    sigma[i][j] = mix_distance(sigma[i][i],sigma[j][j]);
+    lambda[i][j] = 0.5*(lambda[i][i] + lambda[j][j]);
+    if (lambda_lj[i][i] != lambda_lj[j][j] ||
+        lambda_coul[i][i] != lambda_coul[j][j])
+      error->all(FLERR,"Pair ljlambda/soft different lambda_lj or "
+                 "lambda_coul values in mix");
+    lambda_lj[i][j] = lambda_lj[i][i];
+    lambda_coul[i][j] = lambda_coul[i][i];
+    cut_lj[i][j] = mix_distance(cut_lj[i][i],cut_lj[j][j]);
+    cut_coul[i][j] = mix_distance(cut_coul[i][i],cut_coul[j][j]);
+  }
+
+  double cut = MAX(cut_lj[i][j],cut_coul[i][j]);
+  cut_ljsq[i][j] = cut_lj[i][j] * cut_lj[i][j];
+  cut_coulsq[i][j] = cut_coul[i][j] * cut_coul[i][j];
+
+  lj1[i][j] = pow(lambda_lj[i][j],nlambda);
+  lj2[i][j] = pow(sigma[i][j],6.0);
+  lj3[i][j] = alphalj * (1.0-lambda_lj[i][j])*(1.0-lambda_lj[i][j]);
+  lj4[i][j] = 4.0 * epsilon[i][j];
+  coul1[i][j] = pow(lambda_coul[i][j],nlambda);
+  coul2[i][j] = alphac * (1.0-lambda_coul[i][j])*(1.0-lambda_coul[i][j]);
+
+  // same convention as ljlambda: the offset is not scaled by lambda
+
+  if (offset_flag && (cut_lj[i][j] > 0.0)) {
+    double denlj = lj3[i][j] + pow(cut_lj[i][j]/sigma[i][j],6.0);
+    offset[i][j] = lj4[i][j] * (1.0/(denlj*denlj) - 1.0/denlj);
+  } else offset[i][j] = 0.0;
+
+  cut_ljsq[j][i] = cut_ljsq[i][j];
+  cut_coulsq[j][i] = cut_coulsq[i][j];
+  epsilon[j][i] = epsilon[i][j];
+  sigma[j][i] = sigma[i][j];
+  lambda[j][i] = lambda[i][j];
+  lambda_lj[j][i] = lambda_lj[i][j];
+  lambda_coul[j][i] = lambda_coul[i][j];
+  lj1[j][i] = lj1[i][j];
+  lj2[j][i] = lj2[i][j];
+  lj3[j][i] = lj3[i][j];
+  lj4[j][i] = lj4[i][j];
+  offset[j][i] = offset[i][j];
+  coul1[j][i] = coul1[i][j];
+  coul2[j][i] = coul2[i][j];
+
+  return cut;
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 writes to restart file
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::write_restart(FILE *fp)
+{
+  write_restart_settings(fp);
+
+  int i,j;
+  for (i = 1; i <= atom->ntypes; i++)
+    for (j = i; j <= atom->ntypes; j++) {
+      fwrite(&setflag[i][j],sizeof(int),1,fp);
+      if (setflag[i][j]) {
+        fwrite(&epsilon[i][j],sizeof(double),1,fp);
+        fwrite(&sigma[i][j],sizeof(double),1,fp);
+        fwrite(&lambda[i][j],sizeof(double),1,fp);
+        fwrite(&lambda_lj[i][j],sizeof(double),1,fp);
+        fwrite(&lambda_coul[i][j],sizeof(double),1,fp);
+        fwrite(&cut_lj[i][j],sizeof(double),1,fp);
+        fwrite(&cut_coul[i][j],sizeof(double),1,fp);
+      }
+    }
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 reads from restart file, bcasts
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::read_restart(FILE *fp)
+{
+  read_restart_settings(fp);
+  allocate();
+
+  int i,j;
+  int me = comm->me;
+  for (i = 1; i <= atom->ntypes; i++)
+    for (j = i; j <= atom->ntypes; j++) {
+      if (me == 0) utils::sfread(FLERR,&setflag[i][j],sizeof(int),1,fp,NULL,error);
+      MPI_Bcast(&setflag[i][j],1,MPI_INT,0,world);
+      if (setflag[i][j]) {
+        if (me == 0) {
+          utils::sfread(FLERR,&epsilon[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&sigma[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&lambda[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&lambda_lj[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&lambda_coul[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&cut_lj[i][j],sizeof(double),1,fp,NULL,error);
+          utils::sfread(FLERR,&cut_coul[i][j],sizeof(double),1,fp,NULL,error);
+        }
+        MPI_Bcast(&epsilon[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&sigma[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&lambda[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&lambda_lj[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&lambda_coul[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&cut_lj[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&cut_coul[i][j],1,MPI_DOUBLE,0,world);
+      }
+    }
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 writes to restart file
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::write_restart_settings(FILE *fp)
+{
+  fwrite(&nlambda,sizeof(double),1,fp);
+  fwrite(&alphalj,sizeof(double),1,fp);
+  fwrite(&alphac,sizeof(double),1,fp);
+  fwrite(&cut_lj_global,sizeof(double),1,fp);
+  fwrite(&cut_coul_global,sizeof(double),1,fp);
+  fwrite(&kappa,sizeof(double),1,fp);
+  fwrite(&offset_flag,sizeof(int),1,fp);
+  fwrite(&mix_flag,sizeof(int),1,fp);
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 reads from restart file, bcasts
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::read_restart_settings(FILE *fp)
+{
+  if (comm->me == 0) {
+    utils::sfread(FLERR,&nlambda,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&alphalj,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&alphac,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&cut_lj_global,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&cut_coul_global,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&kappa,sizeof(double),1,fp,NULL,error);
+    utils::sfread(FLERR,&offset_flag,sizeof(int),1,fp,NULL,error);
+    utils::sfread(FLERR,&mix_flag,sizeof(int),1,fp,NULL,error);
+  }
+  MPI_Bcast(&nlambda,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&alphalj,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&alphac,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&cut_lj_global,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&cut_coul_global,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&kappa,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&offset_flag,1,MPI_INT,0,world);
+  MPI_Bcast(&mix_flag,1,MPI_INT,0,world);
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 writes to data file
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::write_data(FILE *fp)
+{
+  for (int i = 1; i <= atom->ntypes; i++)
+    fprintf(fp,"%d %g %g %g %g %g\n",i,epsilon[i][i],sigma[i][i],
+            lambda[i][i],lambda_lj[i][i],lambda_coul[i][i]);
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 writes all pairs to data file
+------------------------------------------------------------------------- */
+
+void PairLJLambdaSoft::write_data_all(FILE *fp)
+{
+  for (int i = 1; i <= atom->ntypes; i++)
+    for (int j = i; j <= atom->ntypes; j++)
+      fprintf(fp,"%d %d %g %g %g %g %g %g %g\n",i,j,epsilon[i][j],sigma[i][j],
+              lambda[i][j],lambda_lj[i][j],lambda_coul[i][j],
+              cut_lj[i][j],cut_coul[i][j]);
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairLJLambdaSoft::single(int i, int j, int itype, int jtype,
+                                double rsq,
+                                double factor_coul, double factor_lj,
+                                double &fforce)
+{
+  double forcecoul,forcelj,phicoul,philj;
+  double denc,screening,denlj,u,s6;
+
+  denc = screening = denlj = u = 0.0;
+
+  if (rsq < cut_coulsq[itype][jtype]) {
+    denc = sqrt(coul2[itype][jtype] + rsq);
+    screening = exp(-kappa*denc);
+    forcecoul = force->qqrd2e * coul1[itype][jtype] * atom->q[i]*atom->q[j] *
+      screening * (kappa + 1.0/denc) / (denc*denc);
+  } else forcecoul = 0.0;
+
+  if (rsq < cut_ljsq[itype][jtype]) {
+    s6 = rsq*rsq*rsq / lj2[itype][jtype];
+    denlj = lj3[itype][jtype] + s6;
+    u = 1.0/denlj;
+    forcelj = lj1[itype][jtype] * lj4[itype][jtype] *
+      (2.0*u*u*u - u*u) * 6.0*s6/rsq;
+    if (denlj > 2.0) forcelj *= lambda[itype][jtype];
+  } else forcelj = 0.0;
+
+  fforce = factor_coul*forcecoul + factor_lj*forcelj;
+
+  double eng = 0.0;
+  if (rsq < cut_coulsq[itype][jtype]) {
+    phicoul = force->qqrd2e * coul1[itype][jtype] * atom->q[i]*atom->q[j] *
+      screening / denc;
+    eng += factor_coul*phicoul;
+  }
+  if (rsq < cut_ljsq[itype][jtype]) {
+    if (denlj <= 2.0)
+      philj = lj1[itype][jtype] * (lj4[itype][jtype]*(u*u - u) +
+        (1.0-lambda[itype][jtype])*epsilon[itype][jtype]);
+    else
+      philj = lj1[itype][jtype] * (lambda[itype][jtype] *
+        lj4[itype][jtype]*(u*u - u) - offset[itype][jtype]);
+    eng += factor_lj*philj;
+  }
+
+  return eng;
+}
+
+/* ----------------------------------------------------------------------
+   epsilon, sigma, lambda, lambda_lj and lambda_coul can be ramped by
+   fix adapt or perturbed by compute fep
+------------------------------------------------------------------------- */
+
+void *PairLJLambdaSoft::extract(const char *str, int &dim)
+{
+  dim = 0;
+  if (strcmp(str,"cut_coul") == 0) return (void *) &cut_coul_global;
+  if (strcmp(str,"kappa") == 0) return (void *) &kappa;
+  dim = 2;
+  if (strcmp(str,"epsilon") == 0) return (void *) epsilon;
+  if (strcmp(str,"sigma") == 0) return (void *) sigma;
+  if (strcmp(str,"lambda") == 0) return (void *) lambda;
+  if (strcmp(str,"lambda_lj") == 0) return (void *) lambda_lj;
+  if (strcmp(str,"lambda_coul") == 0) return (void *) lambda_coul;
+  return NULL;
+}
@@ -0,0 +1,93 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Soft-core ljlambda for alchemical changes, with separate coupling
+   parameters for the LJ-lambda and Debye-Hueckel terms; based on
+   lj_cut_coul_cut_soft.h
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(ljlambda/soft,PairLJLambdaSoft)
+
+#else
+
+#ifndef LMP_PAIR_LJLAMBDA_SOFT_H
+#define LMP_PAIR_LJLAMBDA_SOFT_H
+
+#include "pair.h"
+
+namespace LAMMPS_NS {
+
+class PairLJLambdaSoft : public Pair {
+ public:
+  PairLJLambdaSoft(class LAMMPS *);
+  virtual ~PairLJLambdaSoft();
+  virtual void compute(int, int);
+  virtual void settings(int, char **);
+  void coeff(int, char **);
+  void init_style();
+  double init_one(int, int);
+  void write_restart(FILE *);
+  void read_restart(FILE *);
+  virtual void write_restart_settings(FILE *);
+  virtual void read_restart_settings(FILE *);
+  void write_data(FILE *);
+  void write_data_all(FILE *);
+  virtual double single(int, int, int, int, double, double, double, double &);
+  void *extract(const char *, int &);
+
+ protected:
+  double cut_lj_global,cut_coul_global;
+  double **cut_lj,**cut_ljsq;
+  double **cut_coul,**cut_coulsq;
+  double **epsilon,**sigma;
+  double **lambda;             // HPS hydropathy scaling of the attraction
+  double **lambda_lj,**lambda_coul;  // alchemical couplings, 1 = full
+  double **lj1,**lj2,**lj3,**lj4,**offset;
+  double **coul1,**coul2;
+  double kappa;
+  double nlambda,alphalj,alphac;
+
+  void allocate();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Incorrect args for pair coefficients
+
+Self-explanatory.  Check the input script or data file.
+
+E: Pair style ljlambda/soft requires atom attribute q
+
+The atom style defined does not have this attribute.
+
+E: Pair style ljlambda/soft does not support kspace
+
+The soft-core Debye-Hueckel term has no long-range counterpart.
+
+E: Pair ljlambda/soft different lambda_lj or lambda_coul values in mix
+
+The alchemical couplings of an I,J pair are not mixed, set them with
+pair_coeff I J.
+
+*/
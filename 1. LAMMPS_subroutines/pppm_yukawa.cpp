@@ -0,0 +1,221 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <cmath>
+#include "pppm_yukawa.h"
+#include "atom.h"
+#include "domain.h"
+#include "force.h"
+#include "pair.h"
+#include "math_const.h"
+#include "math_special.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+using namespace MathSpecial;
+
+#define EPS_HOC 1.0e-7
+
+/* ----------------------------------------------------------------------
+   kspace_style pppm/yukawa accuracy
+   screened Coulomb qi qj exp(-kappa r)/r is split as
+     real space   [exp(-kappa r) erfc(g r - kappa/2g)
+                   + exp(kappa r) erfc(g r + kappa/2g)] / 2r   (pair ljlambda)
+     k-space      4 pi exp(-(k^2+kappa^2)/4g^2) / (k^2+kappa^2)
+   for kappa -> 0 both reduce to the Ewald split of pppm
+------------------------------------------------------------------------- */
+
+PPPMYukawa::PPPMYukawa(LAMMPS *lmp) : PPPM(lmp)
+{
+  kappa = 0.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PPPMYukawa::init()
+{
+  if (force->pair == NULL || force->pair_match("ljlambda",0) == NULL)
+    error->all(FLERR,"KSpace style pppm/yukawa requires pair style ljlambda");
+
+  int itmp;
+  double *p_kappa = (double *) force->pair->extract("kappa",itmp);
+  if (p_kappa == NULL)
+    error->all(FLERR,"KSpace style pppm/yukawa requires pair style ljlambda");
+  kappa = *p_kappa;
+  if (kappa <= 0.0)
+    error->all(FLERR,"KSpace style pppm/yukawa requires kappa > 0");
+
+  if (differentiation_flag == 1)
+    error->all(FLERR,"KSpace style pppm/yukawa does not support "
+               "kspace_modify diff ad");
+  if (slabflag || domain->triclinic)
+    error->all(FLERR,"KSpace style pppm/yukawa does not support slab "
+               "or triclinic boxes");
+
+  // g_ewald and grid are estimated with the unscreened Coulomb error
+  // bounds of pppm, which are conservative for kappa > 0
+
+  PPPM::init();
+}
+
+/* ----------------------------------------------------------------------
+   pppm setup, then virial coefficients for the screened Green's function
+   d ln G / d k^2 = -(1/(k^2+kappa^2) + 1/4g^2)
+------------------------------------------------------------------------- */
+
+void PPPMYukawa::setup()
+{
+  PPPM::setup();
+
+  const double kappasq = kappa*kappa;
+  double sqk,vterm;
+  int i,j,k,n;
+
+  n = 0;
+  for (k = nzlo_fft; k <= nzhi_fft; k++) {
+    for (j = nylo_fft; j <= nyhi_fft; j++) {
+      for (i = nxlo_fft; i <= nxhi_fft; i++) {
+        sqk = fkx[i]*fkx[i] + fky[j]*fky[j] + fkz[k]*fkz[k];
+        vterm = -2.0 * (1.0/(sqk+kappasq) + 0.25/(g_ewald*g_ewald));
+        vg[n][0] = 1.0 + vterm*fkx[i]*fkx[i];
+        vg[n][1] = 1.0 + vterm*fky[j]*fky[j];
+        vg[n][2] = 1.0 + vterm*fkz[k]*fkz[k];
+        vg[n][3] = vterm*fkx[i]*fky[j];
+        vg[n][4] = vterm*fkx[i]*fkz[k];
+        vg[n][5] = vterm*fky[j]*fkz[k];
+        n++;
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   compute the optimized influence function for ik differentiation
+   (Hockney-Eastwood) with the screened reference force;
+   the k = 0 term is finite, so net charge needs no background
+------------------------------------------------------------------------- */
+
+void PPPMYukawa::compute_gf_ik()
+{
+  const double * const prd = domain->prd;
+
+  const double xprd = prd[0];
+  const double yprd = prd[1];
+  const double zprd = prd[2];
+  const double unitkx = (MY_2PI/xprd);
+  const double unitky = (MY_2PI/yprd);
+  const double unitkz = (MY_2PI/zprd);
+  const double kappasq = kappa*kappa;
+  const double gsqinv = 1.0/(g_ewald*g_ewald);
+
+  double snx,sny,snz;
+  double argx,argy,argz,wx,wy,wz,sx,sy,sz,qx,qy,qz;
+  double sum1,dot1,dot2;
+  double numerator,denominator;
+  double sqk;
+
+  int k,l,m,n,kper,lper,mper,nx,ny,nz;
+
+  const int nbx = static_cast<int> ((g_ewald*xprd/(MY_PI*nx_pppm)) *
+                                    pow(-log(EPS_HOC),0.25));
+  const int nby = static_cast<int> ((g_ewald*yprd/(MY_PI*ny_pppm)) *
+                                    pow(-log(EPS_HOC),0.25));
+  const int nbz = static_cast<int> ((g_ewald*zprd/(MY_PI*nz_pppm)) *
+                                    pow(-log(EPS_HOC),0.25));
+  const int twoorder = 2*order;
+
+  n = 0;
+  for (m = nzlo_fft; m <= nzhi_fft; m++) {
+    mper = m - nz_pppm*(2*m/nz_pppm);
+    snz = square(sin(0.5*unitkz*mper*zprd/nz_pppm));
+
+    for (l = nylo_fft; l <= nyhi_fft; l++) {
+      lper = l - ny_pppm*(2*l/ny_pppm);
+      sny = square(sin(0.5*unitky*lper*yprd/ny_pppm));
+
+      for (k = nxlo_fft; k <= nxhi_fft; k++) {
+        kper = k - nx_pppm*(2*k/nx_pppm);
+        snx = square(sin(0.5*unitkx*kper*xprd/nx_pppm));
+
+        sqk = square(unitkx*kper) + square(unitky*lper) + square(unitkz*mper);
+
+        if (sqk != 0.0) {
+          numerator = MY_4PI/sqk;
+          denominator = gf_denom(snx,sny,snz);
+          sum1 = 0.0;
+
+          for (nx = -nbx; nx <= nbx; nx++) {
+            qx = unitkx*(kper+nx_pppm*nx);
+            sx = exp(-0.25*qx*qx*gsqinv);
+            argx = 0.5*qx*xprd/nx_pppm;
+            wx = powsinxx(argx,twoorder);
+
+            for (ny = -nby; ny <= nby; ny++) {
+              qy = unitky*(lper+ny_pppm*ny);
+              sy = exp(-0.25*qy*qy*gsqinv);
+              argy = 0.5*qy*yprd/ny_pppm;
+              wy = powsinxx(argy,twoorder);
+
+              for (nz = -nbz; nz <= nbz; nz++) {
+                qz = unitkz*(mper+nz_pppm*nz);
+                sz = exp(-0.25*qz*qz*gsqinv);
+                argz = 0.5*qz*zprd/nz_pppm;
+                wz = powsinxx(argz,twoorder);
+
+                dot1 = unitkx*kper*qx + unitky*lper*qy + unitkz*mper*qz;
+                dot2 = qx*qx + qy*qy + qz*qz;
+                sum1 += (dot1/(dot2+kappasq)) * sx*sy*sz * wx*wy*wz;
+              }
+            }
+          }
+          greensfn[n++] = numerator*sum1/denominator *
+            exp(-0.25*kappasq*gsqinv);
+        } else greensfn[n++] = MY_4PI/kappasq * exp(-0.25*kappasq*gsqinv);
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   pppm compute, then replace the Coulomb self-energy and neutralizing
+   background terms by the screened self-energy
+     qi^2 (g/sqrt(pi) exp(-kappa^2/4g^2) - kappa/2 erfc(kappa/2g))
+------------------------------------------------------------------------- */
+
+void PPPMYukawa::compute(int eflag, int vflag)
+{
+  PPPM::compute(eflag,vflag);
+
+  if (!eflag_global && !eflag_atom) return;
+
+  const double qscale = qqrd2e * scale;
+  const double a = 0.5*kappa/g_ewald;
+  const double eself = g_ewald*exp(-a*a)/MY_PIS - 0.5*kappa*erfc(a);
+  const double gsqvinv = 1.0/(g_ewald*g_ewald*volume);
+
+  if (eflag_global) {
+    energy += qscale * (g_ewald*qsqsum/MY_PIS + MY_PI2*qsum*qsum*gsqvinv);
+    energy -= qscale * qsqsum*eself;
+  }
+
+  if (eflag_atom) {
+    double *q = atom->q;
+    int nlocal = atom->nlocal;
+    for (int i = 0; i < nlocal; i++) {
+      eatom[i] += qscale * (g_ewald*q[i]*q[i]/MY_PIS +
+                            MY_PI2*q[i]*qsum*gsqvinv);
+      eatom[i] -= qscale * q[i]*q[i]*eself;
+    }
+  }
+}
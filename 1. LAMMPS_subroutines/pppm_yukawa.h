@@ -0,0 +1,67 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Long-range Debye-Hueckel (Yukawa) electrostatics for pair ljlambda:
+   PPPM with the Green's function 4 pi exp(-(k^2+kappa^2)/4g^2)/(k^2+kappa^2),
+   the matching erfc-split real-space part is evaluated by the pair style
+------------------------------------------------------------------------- */
+
+#ifdef KSPACE_CLASS
+
+KSpaceStyle(pppm/yukawa,PPPMYukawa)
+
+#else
+
+#ifndef LMP_PPPM_YUKAWA_H
+#define LMP_PPPM_YUKAWA_H
+
+#include "pppm.h"
+
+namespace LAMMPS_NS {
+
+class PPPMYukawa : public PPPM {
+ public:
+  PPPMYukawa(class LAMMPS *);
+  virtual ~PPPMYukawa() {}
+  virtual void init();
+  virtual void setup();
+  virtual void compute(int, int);
+
+ protected:
+  double kappa;                // inverse Debye length from the pair style
+
+  virtual void compute_gf_ik();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: KSpace style pppm/yukawa requires pair style ljlambda
+
+The screening length is taken from the pair style.
+
+E: KSpace style pppm/yukawa requires kappa > 0
+
+Use kspace_style pppm for unscreened Coulomb.
+
+E: KSpace style pppm/yukawa does not support kspace_modify diff ad
+
+Only ik differentiation is implemented.
+
+E: KSpace style pppm/yukawa does not support slab or triclinic boxes
+
+Self-explanatory.
+
+*/
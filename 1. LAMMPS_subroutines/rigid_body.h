@@ -0,0 +1,83 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+   Rigid body ID of the HPS-SS styles ("rigid i_name"): lookup of the
+   integer per-atom property and its restart record
+------------------------------------------------------------------------- */
+
+#ifndef LMP_RIGID_BODY_H
+#define LMP_RIGID_BODY_H
+
+#include <mpi.h>
+#include <cstdio>
+#include <cstring>
+#include "atom.h"
+#include "modify.h"
+#include "fix.h"
+#include "error.h"
+#include "utils.h"
+
+namespace LAMMPS_NS {
+
+namespace RigidBody {
+
+  // index of i_name, body IDs of ghosts are read in every style, so the
+  // values must come with the ghosts: fix property/atom ... ghost yes
+  // (comm_border > 0); the 29Oct2020 fix does not tell which names it
+  // holds, so with several property/atom fixes one with ghost yes passes
+
+  inline int find(Atom *atom, Modify *modify, Error *error,
+                  const char *name, const char *style) {
+    char str[128];
+    int flag;
+    int index = atom->find_custom(name,flag);
+    if (index < 0 || flag != 0) {
+      snprintf(str,128,"Rigid body property for %s does not exist",style);
+      error->all(FLERR,str);
+    }
+
+    int ghost = 0;
+    for (int i = 0; i < modify->nfix; i++)
+      if (strcmp(modify->fix[i]->style,"property/atom") == 0 &&
+          modify->fix[i]->comm_border > 0) ghost = 1;
+    if (!ghost) {
+      snprintf(str,128,"Rigid body property for %s needs "
+               "fix property/atom ghost yes",style);
+      error->all(FLERR,str);
+    }
+    return index;
+  }
+
+  // name with length, "" = no rigid keyword
+
+  inline void write(FILE *fp, const char *name) {
+    int n = name ? strlen(name) + 1 : 0;
+    fwrite(&n,sizeof(int),1,fp);
+    if (n) fwrite(name,sizeof(char),n,fp);
+  }
+
+  inline void read(FILE *fp, char *&name, int me, MPI_Comm world,
+                   Error *error) {
+    int n = 0;
+    if (me == 0) utils::sfread(FLERR,&n,sizeof(int),1,fp,NULL,error);
+    MPI_Bcast(&n,1,MPI_INT,0,world);
+    delete [] name;
+    name = NULL;
+    if (n == 0) return;
+    name = new char[n];
+    if (me == 0) utils::sfread(FLERR,name,sizeof(char),n,fp,NULL,error);
+    MPI_Bcast(name,n,MPI_CHAR,0,world);
+  }
+}
+
+}
+
+#endif
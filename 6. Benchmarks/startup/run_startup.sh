@@ -0,0 +1,20 @@
+#!/bin/bash
+# Time LAMMPS startup for an increasing number of atom types and copies.
+# usage: ./run_startup.sh [lmp executable] [data file]
+# writes startup.dat: ntypes nrep natoms wall(s)
+
+LMP=${1:-lmp}
+DATA=${2:-"../../4. Validation/FUS_LC_validation/in.data"}
+
+echo "# ntypes nrep natoms wall(s)" > startup.dat
+for nrep in 1 4 8; do
+  for ntypes in 10 20 50 100 200 400; do
+    $LMP -in in.startup -log none -screen startup.tmp \
+         -var data "$DATA" -var ntypes $ntypes -var nrep $nrep
+    natoms=$(awk '/^ *[0-9]+ atoms *$/ {n=$1} END {print n}' startup.tmp)
+    wall=$(awk '/Total wall time/ {split($4,t,":"); print t[1]*3600+t[2]*60+t[3]}' startup.tmp)
+    echo "$ntypes $nrep $natoms $wall" >> startup.dat
+  done
+done
+rm -f startup.tmp
+cat startup.dat
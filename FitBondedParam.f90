@@ -0,0 +1,694 @@
+program main
+
+  use mtmod
+  !$ use omp_lib
+
+  implicit none
+
+  integer, parameter :: MAXFRAME = 2000000000
+  integer, parameter :: NCHUNK = 1000
+  integer, parameter :: NPA = 6, NPD = 12
+  integer, parameter :: MTD_RE = 1, MTD_IBI = 2
+  real(8), parameter :: PI = 3.14159265358979323846d0
+  real(8), parameter :: KB_KCAL = 0.0019872041d0
+  character (len=255) :: infile, outfile, initfile, cgafile, cgdfile, line
+  character (len=80), allocatable :: ARGM(:)
+  character (len=8) :: method
+  integer :: narg, i, j, k, ierr, imc, istage, ip
+  integer :: sd, natom, magic, step, neq, numat, molid(2), rngseed, NMC
+  integer :: nbina, nbind, nframe, nchunk_read, ichunk, mtd, nthreads
+  real(4) :: time, prec, box(9)
+  real(4), allocatable :: xt(:,:)
+  real(8), allocatable :: x0(:,:)
+  real(8) :: boxsize(3), cm(3), temp, kT, xx, lnL, lnL_new, scale
+  real(8) :: theta, phi, b1(3), b2(3)
+  real(8) :: pa(NPA), pd(NPD), pa0(NPA), pd0(NPD)
+  logical :: fita(NPA), fitd(NPD)
+  character (len=4), dimension(NPA) :: namea
+  character (len=4), dimension(NPD) :: named
+  real(8), dimension(:), allocatable :: hista, histd, xca, xcd, jaca, jacd
+  real(8), dimension(:), allocatable :: uta, utd, wta, wtd
+
+  data namea /'gam','k1','k2','t1','t2','epsa'/
+  data named /'ka','kb','kc','kd','fa','fb','fc','fd','eb0','ec0','ed0','epsd'/
+
+! current shape constants of AngleBCH and DihedralGaussian
+  pa = (/ 0.1d0, 106.4d0, 26.3d0, 1.60d0, 2.27d0, 4.3d0 /)
+  pd = (/ 11.4d0, 0.15d0, 1.8d0, 0.65d0, 0.9d0, 1.02d0, -1.55d0, -2.5d0, &
+          0.27d0, 0.14d0, 0.26d0, 0.0d0 /)
+  fita = (/ .FALSE., .TRUE., .TRUE., .TRUE., .TRUE., .FALSE. /)
+  fitd = .TRUE.
+  fitd(NPD) = .FALSE.
+
+  narg = iargc()
+  if (narg < 1) then
+     call print_usage()
+     stop
+  else
+     allocate(ARGM(narg))
+     do i = 1, narg
+        call getarg(i,ARGM(i))
+     end do
+     infile = ''
+     outfile = ''
+     initfile = ''
+     cgafile = ''
+     cgdfile = ''
+     method = 're'
+     molid = 0
+     neq = 0
+     nbina = 90
+     nbind = 120
+     temp = 300.d0
+     rngseed = 1234567
+     NMC = 100000
+     do i = 1, narg-1
+        select case (trim(ARGM(i)))
+        case ('-x','-xtc')
+           infile = trim(ARGM(i+1))
+        case ('-o','-out')
+           outfile = trim(ARGM(i+1))
+        case ('-init')
+           initfile = trim(ARGM(i+1))
+        case ('-cga')
+           cgafile = trim(ARGM(i+1))
+        case ('-cgd')
+           cgdfile = trim(ARGM(i+1))
+        case ('-method')
+           method = trim(ARGM(i+1))
+        case ('-m','-mol')
+           read(ARGM(i+1),*,iostat=ierr) molid(1)
+           if (ierr /= 0) stop 'Invalid entry in -m option!'
+           read(ARGM(i+2),*,iostat=ierr) molid(2)
+        case ('-e','-eq')
+           read(ARGM(i+1),*,iostat=ierr) neq
+           if (ierr /= 0) stop 'Invalid entry in -e option!'
+        case ('-nbin')
+           read(ARGM(i+1),*,iostat=ierr) nbina
+           if (ierr /= 0) stop 'Invalid entry in -nbin option!'
+           read(ARGM(i+2),*,iostat=ierr) nbind
+           if (ierr /= 0) stop 'Invalid entry in -nbin option!'
+        case ('-t','-temp')
+           read(ARGM(i+1),*,iostat=ierr) temp
+           if (ierr /= 0) stop 'Invalid entry in -t option!'
+        case ('-epsa')
+           read(ARGM(i+1),*,iostat=ierr) pa(NPA)
+           if (ierr /= 0) stop 'Invalid entry in -epsa option!'
+        case ('-epsd')
+           read(ARGM(i+1),*,iostat=ierr) pd(NPD)
+           if (ierr /= 0) stop 'Invalid entry in -epsd option!'
+        case ('-s','-seed')
+           read(ARGM(i+1),*,iostat=ierr) rngseed
+           if (ierr /= 0) stop 'Invalid entry in -s option!'
+        case ('-nmc')
+           read(ARGM(i+1),*,iostat=ierr) NMC
+           if (ierr /= 0) stop 'Invalid entry in -nmc option!'
+        case ('-h','-help')
+           call print_usage()
+           stop
+        end select
+     end do
+  end if
+
+  if (rngseed < 1) stop 'Wrong RNG seed!'
+  if (nbina < 2 .or. nbind < 2) stop 'Invalid entry in -nbin option!'
+  select case (trim(method))
+  case ('re')
+     mtd = MTD_RE
+  case ('ibi')
+     mtd = MTD_IBI
+  case default
+     stop 'Invalid entry in -method option!'
+  end select
+  kT = KB_KCAL*temp
+
+! start from a previous fit (the angle_style/dihedral_style lines)
+  if (len_trim(initfile) > 0) then
+     open(10, file=trim(initfile), status='old', iostat=ierr)
+     if (ierr /= 0) stop 'Cannot open the init file!'
+     do while (ierr == 0)
+        read(10, '(a)', iostat=ierr) line
+        if (ierr /= 0) exit
+        if (line(1:11) == 'angle_style') call read_keywords(line, NPA, namea, pa)
+        if (line(1:14) == 'dihedral_style') call read_keywords(line, NPD, named, pd)
+     end do
+     close(10)
+  end if
+  pa0 = pa
+  pd0 = pd
+
+! Read the trajectory
+  call xdrfopen(sd, trim(infile), "r", ierr)
+  if (ierr /= 1) stop 'Cannot open the xtc file!'
+  call xtcheader(sd, magic, natom, step, time, ierr)
+  call xdrfclose(sd, ierr)
+  write(0,*) 'Number of atoms = ', natom
+
+  if (all(molid > 0)) then
+     numat = molid(2) - molid(1) + 1
+  else
+     numat = natom
+     molid(1) = 1
+     molid(2) = natom
+  end if
+  if (numat < 4) stop 'Invalid entry in -m option!'
+
+  allocate(hista(nbina), xca(nbina), jaca(nbina), uta(nbina), wta(nbina))
+  allocate(histd(nbind), xcd(nbind), jacd(nbind), utd(nbind), wtd(nbind))
+  do k = 1, nbina
+     xca(k) = (dble(k) - 0.5d0)*PI/dble(nbina)
+     jaca(k) = sin(xca(k))
+  end do
+  do k = 1, nbind
+     xcd(k) = -PI + (dble(k) - 0.5d0)*2.d0*PI/dble(nbind)
+     jacd(k) = 1.d0
+  end do
+  hista = 0.d0
+  histd = 0.d0
+
+  nthreads = 1
+  !$ nthreads = omp_get_max_threads()
+  write(0,*) 'Number of threads = ', nthreads
+
+! frames are read serially in chunks and histogrammed in parallel
+  allocate(xt(3*natom,NCHUNK))
+  allocate(x0(3,numat))
+  nframe = 0
+  call xdrfopen(sd, trim(infile), "r", ierr)
+  outer: do imc = 1, MAXFRAME
+     nchunk_read = 0
+     do while (nchunk_read < NCHUNK)
+        call readxtc(sd, natom, step, time, box, xt(:,nchunk_read+1), prec, ierr)
+        if (ierr /= 1) exit
+        if (step > neq) nchunk_read = nchunk_read + 1
+     end do
+     if (nchunk_read == 0) exit outer
+     boxsize(1) = dble(box(1)*10.0)
+     boxsize(2) = dble(box(5)*10.0)
+     boxsize(3) = dble(box(9)*10.0)
+
+     !$omp parallel do default(shared) private(ichunk,i,j,k,cm,x0,b1,b2,theta,phi) &
+     !$omp reduction(+:hista,histd)
+     do ichunk = 1, nchunk_read
+        do i = 1, numat
+           cm = dble(xt(3*(molid(1)+i-1)-2:3*(molid(1)+i-1),ichunk)*10.0)
+           if (i == 1) then
+              x0(:,i) = cm
+           else
+              cm = cm - x0(:,i-1)
+              do j = 1, 3
+                 cm(j) = cm(j) - boxsize(j)*ANINT(cm(j)/boxsize(j))
+              end do
+              x0(:,i) = x0(:,i-1) + cm
+           end if
+        end do
+        do i = 2, numat-1
+           b1 = x0(:,i-1) - x0(:,i)
+           b2 = x0(:,i+1) - x0(:,i)
+           theta = dot_product(b1,b2)/sqrt(dot_product(b1,b1)*dot_product(b2,b2))
+           theta = acos(max(-1.d0,min(1.d0,theta)))
+           k = int(theta/PI*dble(nbina)) + 1
+           k = max(1,min(nbina,k))
+           hista(k) = hista(k) + 1.d0
+        end do
+        do i = 1, numat-3
+           phi = ComputeDihedral(x0(:,i),x0(:,i+1),x0(:,i+2),x0(:,i+3))
+           k = int((phi + PI)/(2.d0*PI)*dble(nbind)) + 1
+           k = max(1,min(nbind,k))
+           histd(k) = histd(k) + 1.d0
+        end do
+     end do
+     !$omp end parallel do
+
+     nframe = nframe + nchunk_read
+     if (nchunk_read < NCHUNK) exit outer
+  end do outer
+  call xdrfclose(sd, ierr)
+  write(0,*) 'Number of frames = ', nframe
+  if (nframe == 0) stop 'No frame after equilibration!'
+
+! fit targets: bin weights and, for ibi, the target potential
+  wta = hista
+  wtd = histd
+  if (mtd == MTD_IBI) then
+     call TargetPotential(1, nbina, xca, jaca, hista, pa, cgafile, uta, wta)
+     call TargetPotential(2, nbind, xcd, jacd, histd, pd, cgdfile, utd, wtd)
+  end if
+
+  call sgrnd(rngseed)
+
+  lnL = Objective(1, mtd, pa, nbina, xca, jaca, wta, uta)
+  write(0,*) 'Angle: initial objective = ', lnL
+  do istage = 1, 2
+     scale = 1.d0
+     if (istage == 2) scale = 0.2d0
+     do imc = 1, NMC
+        ip = PickParam(NPA, fita)
+        xx = pa(ip)
+        call MoveParam(1, ip, pa(ip), scale)
+        lnL_new = Objective(1, mtd, pa, nbina, xca, jaca, wta, uta)
+        if (lnL_new > lnL) then
+           lnL = lnL_new
+        else if (istage == 1 .and. grnd() < exp(lnL_new - lnL)) then
+           lnL = lnL_new
+        else
+           pa(ip) = xx
+        end if
+     end do
+  end do
+  write(0,*) 'Angle: final objective = ', lnL
+
+  lnL = Objective(2, mtd, pd, nbind, xcd, jacd, wtd, utd)
+  write(0,*) 'Dihedral: initial objective = ', lnL
+  do istage = 1, 2
+     scale = 1.d0
+     if (istage == 2) scale = 0.2d0
+     do imc = 1, NMC
+        ip = PickParam(NPD, fitd)
+        xx = pd(ip)
+        call MoveParam(2, ip, pd(ip), scale)
+        lnL_new = Objective(2, mtd, pd, nbind, xcd, jacd, wtd, utd)
+        if (lnL_new > lnL) then
+           lnL = lnL_new
+        else if (istage == 1 .and. grnd() < exp(lnL_new - lnL)) then
+           lnL = lnL_new
+        else
+           pd(ip) = xx
+        end if
+     end do
+  end do
+  write(0,*) 'Dihedral: final objective = ', lnL
+
+! coefficients, ready to paste into the LAMMPS input
+  open(10, file=trim(outfile), status='unknown', iostat=ierr)
+  if (ierr /= 0) stop 'Cannot open the outfile!'
+  write(10,'(a,a,a,f8.2,a,i10,a)') '# FitBondedParam: method ', trim(method), &
+     ', T = ', temp, ' K, ', nframe, ' frames'
+  write(10,'(a,5(1x,a,1x,f12.6))') 'angle_style     bch', &
+     (trim(namea(i)), pa(i), i = 1, NPA-1)
+  write(10,'(a,11(1x,a,1x,f12.6))') 'dihedral_style  gaussian', &
+     (trim(named(i)), pd(i), i = 1, NPD-1)
+  write(10,'(a,f12.6)') '# angle_coeff    1 ', pa(NPA)
+  write(10,'(a,f12.6)') '# eps_d used in the fit = ', pd(NPD)
+  close(10)
+
+! target and fitted distributions for checking
+  call WriteTable(trim(outfile)//'.angle', 1, nbina, xca, jaca, hista, pa0, pa)
+  call WriteTable(trim(outfile)//'.dihed', 2, nbind, xcd, jacd, histd, pd0, pd)
+
+contains
+
+  subroutine print_usage()
+
+    implicit none
+
+    write (0, '(a)') "Usage: getbondedfit OPTIONS"
+    write (0, '(a)') "       OPTIONS:::"
+    write (0, '(a)') "       -x(-xtc): xtc file (CA only)"
+    write (0, '(a)') "       -o(-out): output file"
+    write (0, '(a)') "       -method: re (relative entropy) or ibi (iterative Boltzmann inversion)"
+    write (0, '(a)') "       -init: previous output file to start from"
+    write (0, '(a)') "       -cga: CG angle distribution for ibi (x P)"
+    write (0, '(a)') "       -cgd: CG dihedral distribution for ibi (x P)"
+    write (0, '(a)') "       -m(-mol): molecule id (start end)"
+    write (0, '(a)') "       -e(-eq): equilibration step"
+    write (0, '(a)') "       -nbin: number of angle and dihedral bins"
+    write (0, '(a)') "       -t(-temp): temperature (K)"
+    write (0, '(a)') "       -epsa: angle epsilon held fixed in the fit"
+    write (0, '(a)') "       -epsd: eps_d held fixed in the fit"
+    write (0, '(a)') "       -s(-seed): RNG seed"
+    write (0, '(a)') "       -nmc: number of MC steps"
+    write (0, '(a)') "       -h(-help): help"
+
+  end subroutine print_usage
+
+  function UAngle(p, x) result(u)
+
+    implicit none
+
+    real(8), intent(in) :: p(NPA), x
+    real(8) :: u
+    real(8) :: e1, e2, emax
+
+!   same form as AngleBCH::compute(), evaluated as a stable log-sum-exp
+    e1 = -p(1)*(p(2)*(x - p(4))**2 + p(6))
+    e2 = -p(1)*p(3)*(x - p(5))**2
+    emax = max(e1,e2)
+    u = -(emax + log(exp(e1 - emax) + exp(e2 - emax)))/p(1)
+
+  end function UAngle
+
+  function UDihedral(p, x) result(u)
+
+    implicit none
+
+    real(8), intent(in) :: p(NPD), x
+    real(8) :: u
+    real(8) :: e(7), emax
+
+!   same form as DihedralGaussian::compute()
+    e(1) = -p(1)*(x - p(5))**2 - p(12)
+    e(2) = -p(2)*(x - p(6))**4 + p(9)
+    e(3) = -p(2)*(x - p(6) + 2.d0*PI)**4 + p(9)
+    e(4) = -p(3)*(x - p(7))**2 + p(12) + p(10)
+    e(5) = -p(3)*(x - p(7) - 2.d0*PI)**2 + p(12) + p(10)
+    e(6) = -p(4)*(x - p(8))**4 + p(11) + p(10)
+    e(7) = -p(4)*(x - p(8) - 2.d0*PI)**4 + p(11) + p(10)
+    emax = maxval(e)
+    u = -(emax + log(sum(exp(e - emax))))
+
+  end function UDihedral
+
+  function UModel(itype, p, x) result(u)
+
+    implicit none
+
+    integer, intent(in) :: itype
+    real(8), intent(in) :: p(:), x
+    real(8) :: u
+
+    if (itype == 1) then
+       u = UAngle(p, x)
+    else
+       u = UDihedral(p, x)
+    end if
+
+  end function UModel
+
+  function Objective(itype, mt, p, nb, xc, jac, wt, ut) result(y)
+
+    implicit none
+
+!   re : log-likelihood of the histogram under the model distribution,
+!        i.e. minus the relative entropy times the number of samples
+!   ibi: weighted least squares of the model against the target potential,
+!        up to the free additive constant
+
+    integer, intent(in) :: itype, mt, nb
+    real(8), intent(in) :: p(:), xc(nb), jac(nb), wt(nb), ut(nb)
+    real(8) :: y
+    real(8) :: lw(nb), lwmax, lnZ, c, wsum
+    integer :: k
+
+    if (mt == MTD_RE) then
+       do k = 1, nb
+          lw(k) = log(jac(k)) - UModel(itype, p, xc(k))/kT
+       end do
+       lwmax = maxval(lw)
+       lnZ = lwmax + log(sum(exp(lw - lwmax)))
+       y = sum(wt*(lw - lnZ))
+    else
+       do k = 1, nb
+          lw(k) = (UModel(itype, p, xc(k)) - ut(k))/kT
+       end do
+       wsum = sum(wt)
+       c = sum(wt*lw)/wsum
+       y = -0.5d0*sum(wt*(lw - c)**2)
+    end if
+
+  end function Objective
+
+  subroutine TargetPotential(itype, nb, xc, jac, hist, p, cgfile, ut, wt)
+
+    implicit none
+
+!   Boltzmann inversion of the target; with a CG distribution from the
+!   current parameters this is one step of iterative Boltzmann inversion
+
+    integer, intent(in) :: itype, nb
+    real(8), intent(in) :: xc(nb), jac(nb), hist(nb), p(:)
+    character (len=*), intent(in) :: cgfile
+    real(8), intent(out) :: ut(nb), wt(nb)
+    real(8) :: pt(nb), pcg(nb)
+    integer :: k
+
+    pt = hist/sum(hist)
+    wt = hist
+    ut = 0.d0
+    if (len_trim(cgfile) == 0) then
+       do k = 1, nb
+          if (pt(k) > 0.d0) ut(k) = -kT*log(pt(k)/jac(k))
+       end do
+    else
+       call ReadDistribution(cgfile, nb, xc, pcg)
+       pcg = pcg/sum(pcg)
+       do k = 1, nb
+          if (pt(k) > 0.d0 .and. pcg(k) > 0.d0) then
+             ut(k) = UModel(itype, p, xc(k)) + kT*log(pcg(k)/pt(k))
+          else
+             wt(k) = 0.d0
+          end if
+       end do
+    end if
+
+  end subroutine TargetPotential
+
+  subroutine ReadDistribution(filename, nb, xc, pb)
+
+    implicit none
+
+!   two columns (x P), e.g. one column of compute bonded/hist output,
+!   linearly interpolated onto the bins used here
+
+    character (len=*), intent(in) :: filename
+    integer, intent(in) :: nb
+    real(8), intent(in) :: xc(nb)
+    real(8), intent(out) :: pb(nb)
+    real(8), allocatable :: xr(:), pr(:)
+    character (len=255) :: line
+    integer :: n, k, l, ierr
+
+    n = NumberRow(filename)
+    allocate(xr(n), pr(n))
+    open(11, file=trim(filename), status='old', iostat=ierr)
+    if (ierr /= 0) stop 'Cannot open the CG distribution file!'
+    l = 0
+    do while (l < n)
+       read(11, '(a)', iostat=ierr) line
+       if (ierr /= 0) exit
+       if (len_trim(line) == 0 .or. line(1:1) == '#') cycle
+       l = l + 1
+       read(line, *, iostat=ierr) xr(l), pr(l)
+       if (ierr /= 0) stop 'Invalid entry in the CG distribution file!'
+    end do
+    close(11)
+    n = l
+    if (n < 2) stop 'Invalid entry in the CG distribution file!'
+
+    do k = 1, nb
+       if (xc(k) <= xr(1)) then
+          pb(k) = pr(1)
+       else if (xc(k) >= xr(n)) then
+          pb(k) = pr(n)
+       else
+          l = 1
+          do while (xr(l+1) < xc(k))
+             l = l + 1
+          end do
+          pb(k) = pr(l) + (pr(l+1) - pr(l))*(xc(k) - xr(l))/(xr(l+1) - xr(l))
+       end if
+       pb(k) = max(pb(k),0.d0)
+    end do
+
+  end subroutine ReadDistribution
+
+  integer function PickParam(np, fit)
+
+    implicit none
+
+    integer, intent(in) :: np
+    logical, intent(in) :: fit(np)
+    integer :: nfit, k, l
+
+    nfit = count(fit)
+    l = min(int(grnd()*nfit) + 1, nfit)
+    PickParam = 0
+    do k = 1, np
+       if (fit(k)) l = l - 1
+       if (l == 0) then
+          PickParam = k
+          exit
+       end if
+    end do
+
+  end function PickParam
+
+  subroutine MoveParam(itype, ip, x, scale)
+
+    implicit none
+
+!   force constants move in log space, well positions and offsets
+!   additively; positions are reflected back into their range
+
+    integer, intent(in) :: itype, ip
+    real(8), intent(inout) :: x
+    real(8), intent(in) :: scale
+    real(8), parameter :: dlk = 0.2d0
+    real(8), parameter :: dx = 0.05d0
+
+    if ((itype == 1 .and. (ip == 2 .or. ip == 3)) .or. &
+        (itype == 2 .and. ip <= 4)) then
+       x = x*exp(scale*dlk*(grnd() - 0.5d0))
+    else
+       x = x + scale*dx*(grnd() - 0.5d0)
+       if (itype == 1 .and. ip >= 4) then
+          if (x < 0.d0) x = -x
+          if (x > PI) x = 2.d0*PI - x
+       else if (itype == 2 .and. ip >= 5 .and. ip <= 8) then
+          if (x < -PI) x = -2.d0*PI - x
+          if (x > PI) x = 2.d0*PI - x
+       end if
+    end if
+
+  end subroutine MoveParam
+
+  subroutine WriteTable(filename, itype, nb, xc, jac, hist, p0, p)
+
+    implicit none
+
+    character (len=*), intent(in) :: filename
+    integer, intent(in) :: itype, nb
+    real(8), intent(in) :: xc(nb), jac(nb), hist(nb), p0(:), p(:)
+    real(8) :: pt(nb), p0b(nb), pfb(nb), ut, dx
+    integer :: k, ierr
+
+    dx = xc(2) - xc(1)
+    pt = hist/(sum(hist)*dx)
+    do k = 1, nb
+       p0b(k) = jac(k)*exp(-UModel(itype, p0, xc(k))/kT)
+       pfb(k) = jac(k)*exp(-UModel(itype, p, xc(k))/kT)
+    end do
+    p0b = p0b/(sum(p0b)*dx)
+    pfb = pfb/(sum(pfb)*dx)
+
+    open(12, file=filename, status='unknown', iostat=ierr)
+    if (ierr /= 0) stop 'Cannot open the table file!'
+    write(12,'(a)') '# x P_target P_initial P_fit U_target U_fit'
+    do k = 1, nb
+       ut = 0.d0
+       if (pt(k) > 0.d0) ut = -kT*log(pt(k)/jac(k))
+       write(12,'(f10.5,5ES16.6)') xc(k), pt(k), p0b(k), pfb(k), ut, &
+          UModel(itype, p, xc(k))
+    end do
+    close(12)
+
+  end subroutine WriteTable
+
+  subroutine read_keywords(line, np, names, p)
+
+    implicit none
+
+!   keyword/value pairs after the style name
+
+    character (len=*), intent(in) :: line
+    integer, intent(in) :: np
+    character (len=*), intent(in) :: names(np)
+    real(8), intent(inout) :: p(np)
+    character (len=255) :: word, val
+    integer :: i, k, ierr
+
+    i = 1
+    call read_lineblock(i, line, word)
+    call read_lineblock(i, line, word)
+    do
+       call read_lineblock(i, line, word)
+       if (len_trim(word) == 0) exit
+       call read_lineblock(i, line, val)
+       do k = 1, np
+          if (trim(word) == trim(names(k))) then
+             read(val, *, iostat=ierr) p(k)
+             if (ierr /= 0) stop 'Invalid entry in the init file!'
+          end if
+       end do
+    end do
+
+  end subroutine read_keywords
+
+  function ComputeDihedral(x1, x2, x3, x4) result(d)
+
+    implicit none
+
+    real(8), intent(in) :: x1(3), x2(3), x3(3), x4(3)
+    real(8) :: d
+    real(8) :: b1(3), b2(3), b3(3), n1(3), n2(3), m(3)
+    real(8) :: r, x, y
+
+    b1 = x2 - x1
+    b2 = x2 - x3
+    b3 = x4 - x3
+
+    call CrossProduct(b1,b2,n1)
+    call CrossProduct(b2,b3,n2)
+    call CrossProduct(n1,b2,m)
+
+    r = sqrt(dot_product(n1,n1))
+    n1 = n1/r
+    r = sqrt(dot_product(n2,n2))
+    n2 = n2/r
+    r = sqrt(dot_product(m,m))
+    m = m/r
+
+    x = dot_product(n1,n2)
+    y = dot_product(m,n2)
+
+    d = atan2(y,x)
+
+  end function ComputeDihedral
+
+  subroutine CrossProduct(a, b, c)
+
+    implicit none
+
+    real(8), intent(in) :: a(3), b(3)
+    real(8), intent(out) :: c(3)
+
+    c(1) = a(2)*b(3) - a(3)*b(2)
+    c(2) = a(3)*b(1) - a(1)*b(3)
+    c(3) = a(1)*b(2) - a(2)*b(1)
+
+  end subroutine CrossProduct
+
+  integer function NumberRow(filename)
+
+    implicit none
+
+    character (len=*), intent(in) :: filename
+    character (len=255) :: line
+    integer :: ierr
+
+    open(10, file=trim(filename), status='old', iostat=ierr)
+    if (ierr /= 0) stop 'Cannot open the file!'
+    NumberRow = 0
+    do while (ierr == 0)
+       read(10, '(a)', iostat=ierr) line
+       if (ierr == 0 .and. len_trim(line) > 0) NumberRow = NumberRow + 1
+    end do
+    close(10)
+
+  end function NumberRow
+
+  subroutine read_lineblock(i, line, bl)
+
+    implicit none
+
+    integer, intent(inout) :: i
+    character (len=*), intent(in) :: line
+    character (len=*), intent(out) :: bl
+    integer :: i1, i2
+
+    bl = ''
+
+    i1 = i
+    do while (line(i1:i1) == ' ' .and. i1 <= len_trim(line))
+       i1 = i1 + 1
+    end do
+    i2 = i1
+    do while (line(i2:i2) /= ' ' .and. i2 <= len_trim(line))
+       i2 = i2 + 1
+    end do
+    read (line(i1:i2), '(a)') bl
+    i = i2
+
+  end subroutine read_lineblock
+
+end program main
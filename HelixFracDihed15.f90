@@ -4,6 +4,7 @@ program main
 
   integer, parameter :: MAXFRAME = 2000000000
   character (len=255) :: infile, outfile, ndxfile, pdbfile, line
+  character (len=255) :: wfile, bfile
   character (len=255), allocatable :: xtcfile(:)
   integer, allocatable :: indxrep(:,:), idstep(:), indx(:)
   integer, allocatable :: sd(:), step(:)
@@ -27,6 +28,10 @@ program main
   logical, allocatable :: HelixPart(:)
   real(8), dimension(:), allocatable :: hfrac
   real(8), dimension(:,:), allocatable :: hfracsim
+  integer :: nwrow, idw
+  integer, allocatable :: wstep(:)
+  real(8), allocatable :: wframe(:), wblock(:)
+  real(8) :: wgt, wtemp
   logical :: helical
 
   narg = iargc()
@@ -42,6 +47,9 @@ program main
      outfile = ''
      ndxfile = ''
      pdbfile = ''
+     wfile = ''
+     bfile = ''
+     wtemp = 0.d0
      idrep = 0
      molid = 0
      hassign = 0
@@ -107,6 +115,13 @@ program main
            do j = 1, nneighbor
               if (ARGM(i+2)(j:j) == '1') hhh(j) = 1
            end do
+        case ('-w','-weight')
+           wfile = trim(ARGM(i+1))
+        case ('-bias')
+           bfile = trim(ARGM(i+1))
+        case ('-temp')
+           read(ARGM(i+1),*,iostat=ierr) wtemp
+           if (ierr /= 0) stop 'Invalid entry in -temp option!'
         case ('-block')
            read(ARGM(i+1),*,iostat=ierr) nblock
            if (ierr /= 0) stop 'Invalid entry in -block option!'
@@ -118,6 +133,13 @@ program main
   end if
   if (nblock < 1) nblock = 1
 
+! per-frame weights of biased or reweighted runs
+  nwrow = 0
+  if (len_trim(wfile) > 0 .or. len_trim(bfile) > 0) then
+     call ReadWeights(wfile, bfile, wtemp, nwrow, wstep, wframe)
+     write(0,*) 'Number of weighted frames = ', nwrow
+  end if
+
 ! determine the number of replicas
   if (len_trim(ndxfile) > 0) then
      nreplica = NumberColumn(ndxfile) - 1
@@ -206,10 +228,13 @@ program main
   allocate(HelixPart(numat))
   allocate(hfracsim(numat,nblock+1))
 
+  allocate(wblock(nblock+1))
   hfracsim = 0.d0
+  wblock = 0.d0
 
   ntot = 0 
   idi = 1
+  idw = 1
   outer: do imc = 1, MAXFRAME
      do i = 1, nreplica
         call readxtc(sd(i), natom, step(i), time, box, xt(:,i), prec, ierr)
@@ -237,6 +262,19 @@ program main
         else
            idr = 1
         end if
+        wgt = 1.d0
+        if (nwrow > 0) then
+           idn = 0
+           do i = idw, nwrow
+              if (wstep(i) == step(1)) then
+                 idn = i
+                 exit
+              end if
+           end do
+           if (idn == 0) stop 'Step missing in the weight file!'
+           idw = idn
+           wgt = wframe(idn)
+        end if
         boxsize(1) = dble(box(1)*10.0)
         boxsize(2) = dble(box(5)*10.0)
         boxsize(3) = dble(box(9)*10.0)
@@ -286,13 +324,19 @@ program main
         j = (ntot-1)/ntot_block + 1
 
         do i = 1, numat
-           if (HelixPart(i)) hfracsim(i,j) = hfracsim(i,j) + 1.d0
+           if (HelixPart(i)) hfracsim(i,j) = hfracsim(i,j) + wgt
         end do
+        wblock(j) = wblock(j) + wgt
 
      end if
   end do outer
-  hfracsim(:,1:nblock) = hfracsim(:,1:nblock)/dble(ntot_block)
-  hfracsim(:,nblock+1) = sum(hfracsim(:,1:nblock),dim=2)/dble(nblock)
+! weighted ensemble average over all blocks, then the mean of each block
+  hfracsim(:,nblock+1) = 0.d0
+  if (sum(wblock(1:nblock)) > 0.d0) &
+     hfracsim(:,nblock+1) = sum(hfracsim(:,1:nblock),dim=2)/sum(wblock(1:nblock))
+  do j = 1, nblock
+     if (wblock(j) > 0.d0) hfracsim(:,j) = hfracsim(:,j)/wblock(j)
+  end do
 
   do i = 1, nreplica
      call xdrfclose(sd(i), ierr)
@@ -332,10 +376,81 @@ contains
     write (0, '(a)') "       -s(-seed): RNG seed"
     write (0, '(a)') "       -nmc: number of MC steps"
     write (0, '(a)') "       -block: number of blocks"
+    write (0, '(a)') "       -w(-weight): per-frame weights (step weight)"
+    write (0, '(a)') "       -bias: bias energy in kcal/mol (step V), weight = exp(V/kT)"
+    write (0, '(a)') "              static bias only; metadynamics: step V c(t), weight = exp((V-c(t))/kT)"
+    write (0, '(a)') "       -temp: temperature of the biased run (K)"
     write (0, '(a)') "       -h(-help): help"
 
   end subroutine print_usage
 
+  subroutine ReadWeights(wfile, bfile, temp, n, wstep, wframe)
+
+! per-frame weights (step weight) and/or a bias energy (step V in kcal/mol)
+! converted to exp(V/kT); both files must list the same steps
+! exp(V/kT) holds for a static bias only; for metadynamics the bias file
+! has a third column c(t), the time-dependent offset of the bias (e.g. the
+! rct of PLUMED), and the weight is exp((V - c(t))/kT)
+
+    implicit none
+
+    character(len=*), intent(in) :: wfile, bfile
+    real(8), intent(in) :: temp
+    integer, intent(out) :: n
+    integer, allocatable, intent(out) :: wstep(:)
+    real(8), allocatable, intent(out) :: wframe(:)
+    real(8), parameter :: KB = 0.0019872041d0   ! kcal/mol/K
+    real(8), allocatable :: vbias(:)
+    integer :: i, ierr, nb, s, nc
+    real(8) :: ct
+
+    n = 0
+    if (len_trim(wfile) > 0) then
+       n = NumberRow(wfile)
+       allocate(wstep(n), wframe(n))
+       open(11, file=trim(wfile), status='old', iostat=ierr)
+       if (ierr /= 0) stop 'Cannot open the weight file!'
+       do i = 1, n
+          read(11,*,iostat=ierr) wstep(i), wframe(i)
+          if (ierr /= 0) stop 'Invalid entry in the weight file!'
+          if (wframe(i) < 0.d0) stop 'Negative entry in the weight file!'
+       end do
+       close(11)
+    end if
+
+    if (len_trim(bfile) > 0) then
+       if (temp <= 0.d0) stop 'Invalid entry in -temp option!'
+       nb = NumberRow(bfile)
+       if (n == 0) then
+          n = nb
+          allocate(wstep(n), wframe(n))
+          wframe = 1.d0
+       else if (nb /= n) then
+          stop 'Weight and bias files differ in length!'
+       end if
+       allocate(vbias(n))
+       nc = NumberColumn(bfile)
+       open(11, file=trim(bfile), status='old', iostat=ierr)
+       if (ierr /= 0) stop 'Cannot open the bias file!'
+       do i = 1, n
+          if (nc >= 3) then
+             read(11,*,iostat=ierr) s, vbias(i), ct
+             vbias(i) = vbias(i) - ct
+          else
+             read(11,*,iostat=ierr) s, vbias(i)
+          end if
+          if (ierr /= 0) stop 'Invalid entry in the bias file!'
+          if (len_trim(wfile) > 0 .and. s /= wstep(i)) stop 'Weight and bias steps mismatch!'
+          wstep(i) = s
+       end do
+       close(11)
+! shift by the largest bias, only ratios of weights matter
+       wframe = wframe*exp((vbias - maxval(vbias))/(KB*temp))
+       deallocate(vbias)
+    end if
+
+  end subroutine ReadWeights
+
   function HelixFraction(n, m, w, v, id, i) result(h)
 
     implicit none
@@ -0,0 +1,579 @@
+program main
+
+! Per-residue helix fractions at arbitrary temperatures from all replicas
+! of a temperature REMD run (MBAR over the replica temperatures).
+! Every frame of every walker is used: its potential energy and the
+! temperature it was sampled at give the MBAR weight at each target T.
+! Helix rule and options as in HelixFracDihed15.f90.
+
+  implicit none
+
+  integer, parameter :: MAXFRAME = 2000000000
+  integer, parameter :: MAXITER = 100000
+  real(8), parameter :: KB = 0.0019872041d0   ! kcal/mol/K
+  real(8), parameter :: TOL = 1.d-10
+  character (len=255) :: infile, outfile, ndxfile, enefile
+  character (len=255), allocatable :: xtcfile(:)
+  integer, allocatable :: indxrep(:,:), idstep(:), indx(:)
+  integer, allocatable :: sd(:), step(:)
+  integer :: narg, ndihedrange, i, j, k, l, n, it
+  integer :: imc, nreplica, ncomplex, ntemp, ntarget
+  integer :: molid(2), nneighbor, numat, natom, magic, ierr, neq
+  integer :: nrow, nerow, idn, idi, ide, nblock, ntot_block, ib
+  character (len=80), allocatable :: ARGM(:)
+  real(4), allocatable :: xt(:,:)
+  real(8), allocatable :: x0(:,:)
+  real(8) :: boxsize(3), cm(3), r
+  real(4) :: time, prec, box(9)
+  real(8) :: Dihedral, Dihedral2, r14, xave, xstd
+  real(8), allocatable :: dihedrange(:,:)
+  real(8) :: r14range(2)
+  integer, allocatable :: H_Dihedral(:)
+  integer, allocatable :: hhh(:)
+  logical, allocatable :: HelixPart(:)
+  logical :: helical
+
+  ! energies and MBAR
+
+  integer, allocatable :: estep(:), kstate(:,:), Nk(:)
+  real(8), allocatable :: eall(:,:), uene(:,:)
+  real(8), allocatable :: temp(:), target(:), beta(:), btarget(:)
+  real(8), allocatable :: f(:), fnew(:), logden(:,:), wgt(:,:,:), lw(:)
+  real(8), allocatable :: hsum(:,:,:), wsum(:,:), hall(:,:), wall(:), hblk(:)
+  real(8) :: lmax, s, ess
+
+  narg = iargc()
+  if (narg < 1) then
+     call print_usage()
+     stop
+  else
+     allocate(ARGM(narg))
+     do i = 1, narg
+        call getarg(i,ARGM(i))
+     end do
+     infile = ''
+     outfile = ''
+     ndxfile = ''
+     enefile = ''
+     molid = 0
+     nneighbor = 0
+     ndihedrange = 0
+     ntemp = 0
+     ntarget = 0
+     r14range(1) = 0.0
+     r14range(2) = 100.0
+     neq = 0
+     nblock = 1 ! default
+     do i = 1, narg-1
+        select case (trim(ARGM(i)))
+        case ('-x','-xtc')
+           infile = trim(ARGM(i+1))
+        case ('-o','-out')
+           outfile = trim(ARGM(i+1))
+        case ('-n','-ndx')
+           ndxfile = trim(ARGM(i+1))
+        case ('-en','-energy')
+           enefile = trim(ARGM(i+1))
+        case ('-temp')
+           ntemp = 0
+           do j = i+1, narg
+              read(ARGM(j), *, iostat=ierr) r
+              if (ierr /= 0) exit
+              ntemp = ntemp + 1
+           end do
+           if (ntemp == 0) stop 'Invalid entry in -temp option!'
+           allocate(temp(ntemp))
+           do j = 1, ntemp
+              read(ARGM(i+j),*) temp(j)
+           end do
+        case ('-target')
+           ntarget = 0
+           do j = i+1, narg
+              read(ARGM(j), *, iostat=ierr) r
+              if (ierr /= 0) exit
+              ntarget = ntarget + 1
+           end do
+           if (ntarget == 0) stop 'Invalid entry in -target option!'
+           allocate(target(ntarget))
+           do j = 1, ntarget
+              read(ARGM(i+j),*) target(j)
+           end do
+        case ('-dihed','-dihedral')
+           ndihedrange = 0
+           do j = i+1, narg
+              read(ARGM(j), *, iostat=ierr) r
+              if (ierr /= 0) exit
+              ndihedrange = ndihedrange + 1
+           end do
+           if (ndihedrange == 0) stop 'Invalid entry in -dihed option!'
+           if (mod(ndihedrange,2) /= 0) stop 'Invalid entry in -dihed option!'
+           ndihedrange = ndihedrange/2
+
+           allocate(dihedrange(2,ndihedrange))
+           do j = 1, ndihedrange
+              read(ARGM(i+2*(j-1)+1),*,iostat=ierr) dihedrange(1,j)
+              if (ierr /= 0) stop 'Invalid entry in -dihed option!'
+              read(ARGM(i+2*j),*,iostat=ierr) dihedrange(2,j)
+              if (ierr /= 0) stop 'Invalid entry in -dihed option!'
+           end do
+        case ('-r14')
+           read(ARGM(i+1),*,iostat=ierr) r14range(1)
+           if (ierr /= 0) stop 'Invalid entry in -r14 option!'
+           read(ARGM(i+2),*,iostat=ierr) r14range(2)
+           if (ierr /= 0) stop 'Invalid entry in -r14 option!'
+        case ('-m','-mol')
+           read(ARGM(i+1),*,iostat=ierr) molid(1)
+           if (ierr /= 0) stop 'Invalid entry in -m option!'
+           read(ARGM(i+2),*,iostat=ierr) molid(2)
+        case ('-e','-eq')
+           read(ARGM(i+1),*,iostat=ierr) neq
+           if (ierr /= 0) stop 'Invalid entry in -e option!'
+        case ('-nn','-nneighbor')
+           read(ARGM(i+1),*,iostat=ierr) nneighbor
+           if (ierr /= 0) stop 'Invalid entry in -nn option!'
+           if (nneighbor < 1) stop 'Invalid entry in -nn option!'
+           allocate(hhh(nneighbor))
+           hhh = 0
+           do j = 1, nneighbor
+              if (ARGM(i+2)(j:j) == '1') hhh(j) = 1
+           end do
+        case ('-block')
+           read(ARGM(i+1),*,iostat=ierr) nblock
+           if (ierr /= 0) stop 'Invalid entry in -block option!'
+        case ('-h','-help')
+           call print_usage()
+           stop
+        end select
+     end do
+  end if
+  if (nblock < 1) nblock = 1
+  if (nneighbor == 0) stop 'Missing -nn option!'
+  if (ntemp == 0) stop 'Missing -temp option!'
+  if (ntarget == 0) stop 'Missing -target option!'
+  if (len_trim(enefile) == 0) stop 'Missing -en option!'
+
+! trajectories, one per walker
+  nreplica = NumberRow(infile)
+  if (nreplica /= ntemp) stop 'Number of xtc files and temperatures differ!'
+  allocate(xtcfile(nreplica))
+  allocate(sd(nreplica))
+  open(10, file=trim(infile), status='old', iostat=ierr)
+  if (ierr /= 0) stop 'Cannot open the infile!'
+  do i = 1, nreplica
+     read(10,'(a)',iostat=ierr) xtcfile(i)
+     if (ierr /= 0) stop 'Invalid entry in the infile!'
+  end do
+  close(10)
+
+! temperature index of every walker (none: walker i stays at temperature i)
+  if (len_trim(ndxfile) > 0) then
+     if (NumberColumn(ndxfile) - 1 /= nreplica) stop 'Invalid ndx file!'
+     nrow = NumberRow(ndxfile)
+     allocate(indxrep(nreplica,nrow))
+     allocate(idstep(nrow))
+     open(10, file=trim(ndxfile), status='old', iostat=ierr)
+     if (ierr /= 0) stop 'Cannot open the ndx file!'
+     do i = 1, nrow
+        read(10,*) idstep(i), indxrep(:,i)
+        if (minval(indxrep(:,i)) < 1) indxrep(:,i) = indxrep(:,i) + 1
+     end do
+     close(10)
+  else
+     nrow = 0
+  end if
+
+! potential energy of every walker: step U_1 ... U_n (kcal/mol)
+  if (NumberColumn(enefile) - 1 /= nreplica) stop 'Invalid energy file!'
+  nerow = NumberRow(enefile)
+  allocate(estep(nerow))
+  allocate(eall(nreplica,nerow))
+  open(10, file=trim(enefile), status='old', iostat=ierr)
+  if (ierr /= 0) stop 'Cannot open the energy file!'
+  do i = 1, nerow
+     read(10,*) estep(i), eall(:,i)
+  end do
+  close(10)
+
+  allocate(step(nreplica))
+  allocate(indx(nreplica))
+  call xdrfopen(sd(1), trim(xtcfile(1)), "r", ierr)
+  if (ierr /= 1) stop 'Cannot open the xtc file!'
+  call xtcheader(sd(1), magic, natom, step(1), time, ierr)
+  call xdrfclose(sd(1), ierr)
+  allocate(xt(3*natom,nreplica))
+  write(0,*) 'Number of atoms = ', natom
+
+  if (all(molid > 0)) then
+     numat = molid(2) - molid(1) + 1
+  else
+     numat = natom
+     molid(1) = 1
+     molid(2) = natom
+  end if
+  if (numat < 5) stop 'Invalid entry in -m option!'
+  allocate(x0(3,numat))
+
+! determine the number of complexes
+  ncomplex = 0
+  call xdrfopen(sd(1), trim(xtcfile(1)), "r", ierr)
+  do imc = 1, MAXFRAME
+     call readxtc(sd(1), natom, step(1), time, box, xt(:,1), prec, ierr)
+     if (ierr /= 1) exit
+     if (step(1) > neq) ncomplex = ncomplex + 1
+  end do
+  call xdrfclose(sd(1), ierr)
+  write(0,*) 'Number of complexes per walker = ', ncomplex
+
+  ntot_block = ncomplex/nblock
+  if (ntot_block < 1) stop 'Fewer complexes than blocks!'
+  write(0,*) 'Number of complexes for each block = ', ntot_block
+
+! pass 1: energy and sampled temperature of every frame
+  allocate(uene(nreplica,ncomplex))
+  allocate(kstate(nreplica,ncomplex))
+  allocate(Nk(ntemp))
+
+  do i = 1, nreplica
+     call xdrfopen(sd(i), trim(xtcfile(i)), "r", ierr)
+     if (ierr /= 1) stop 'Cannot open the xtc file!'
+  end do
+  n = 0
+  idi = 1
+  ide = 1
+  outer1: do imc = 1, MAXFRAME
+     do i = 1, nreplica
+        call readxtc(sd(i), natom, step(i), time, box, xt(:,i), prec, ierr)
+        if (ierr /= 1) exit outer1
+     end do
+     if (any(step /= step(1))) stop 'Steps mismatch!'
+     if (step(1) <= neq) cycle
+     if (n == ncomplex) exit
+     if (nrow > 0) then
+        idn = 0
+        do i = idi, nrow
+           if (idstep(i) == step(1)) then
+              idn = i
+              exit
+           end if
+        end do
+        if (idn == 0) stop 'Step missing in the ndx file!'
+        idi = idn
+        indx = indxrep(:,idn)
+     else
+        do j = 1, nreplica
+           indx(j) = j
+        end do
+     end if
+     idn = 0
+     do i = ide, nerow
+        if (estep(i) == step(1)) then
+           idn = i
+           exit
+        end if
+     end do
+     if (idn == 0) stop 'Step missing in the energy file!'
+     ide = idn
+     n = n + 1
+     uene(:,n) = eall(:,idn)
+     kstate(:,n) = indx
+  end do outer1
+  do i = 1, nreplica
+     call xdrfclose(sd(i), ierr)
+  end do
+  if (n /= ncomplex) stop 'Trajectories have different lengths!'
+
+! MBAR: f_k = -ln sum_n exp(-b_k U_n) / sum_l N_l exp(f_l - b_l U_n)
+  allocate(beta(ntemp))
+  allocate(btarget(ntarget))
+  allocate(f(ntemp))
+  allocate(fnew(ntemp))
+  allocate(logden(nreplica,ncomplex))
+  allocate(lw(ntemp))
+  beta = 1.d0/(KB*temp)
+  btarget = 1.d0/(KB*target)
+
+  Nk = 0
+  do n = 1, ncomplex
+     do j = 1, nreplica
+        Nk(kstate(j,n)) = Nk(kstate(j,n)) + 1
+     end do
+  end do
+  if (any(Nk == 0)) stop 'A temperature has no frames!'
+
+  f = 0.d0
+  do it = 1, MAXITER
+     do n = 1, ncomplex
+        do j = 1, nreplica
+           lw = log(dble(Nk)) + f - beta*uene(j,n)
+           lmax = maxval(lw)
+           logden(j,n) = lmax + log(sum(exp(lw - lmax)))
+        end do
+     end do
+     do k = 1, ntemp
+        lmax = maxval(-beta(k)*uene - logden)
+        fnew(k) = -(lmax + log(sum(exp(-beta(k)*uene - logden - lmax))))
+     end do
+     fnew = fnew - fnew(1)
+     if (maxval(abs(fnew - f)) < TOL) exit
+     f = fnew
+  end do
+  f = fnew
+  write(0,*) 'MBAR iterations = ', it
+  do k = 1, ntemp
+     write(0,'(a,f10.3,a,i10,a,f16.6)') ' T = ', temp(k), '  N = ', Nk(k), &
+          '  f = ', f(k)
+  end do
+
+! normalized weights of every frame at each target temperature
+  allocate(wgt(nreplica,ncomplex,ntarget))
+  do l = 1, ntarget
+     lmax = maxval(-btarget(l)*uene - logden)
+     wgt(:,:,l) = exp(-btarget(l)*uene - logden - lmax)
+     s = sum(wgt(:,:,l))
+     wgt(:,:,l) = wgt(:,:,l)/s
+     ess = 1.d0/sum(wgt(:,:,l)**2)
+     write(0,'(a,f10.3,a,f14.1)') ' target T = ', target(l), &
+          '  effective frames = ', ess
+  end do
+
+! pass 2: weighted helix fractions, overall and per block
+  allocate(H_Dihedral(numat))
+  allocate(HelixPart(numat))
+  allocate(hsum(numat,nblock,ntarget))
+  allocate(wsum(nblock,ntarget))
+  allocate(hall(numat,ntarget))
+  allocate(wall(ntarget))
+  allocate(hblk(nblock))
+  hsum = 0.d0
+  wsum = 0.d0
+  hall = 0.d0
+  wall = 0.d0
+
+  do i = 1, nreplica
+     call xdrfopen(sd(i), trim(xtcfile(i)), "r", ierr)
+  end do
+  n = 0
+  outer2: do imc = 1, MAXFRAME
+     do i = 1, nreplica
+        call readxtc(sd(i), natom, step(i), time, box, xt(:,i), prec, ierr)
+        if (ierr /= 1) exit outer2
+     end do
+     if (step(1) <= neq) cycle
+     if (n == ncomplex) exit
+     n = n + 1
+     ib = (n-1)/ntot_block + 1
+     boxsize(1) = dble(box(1)*10.0)
+     boxsize(2) = dble(box(5)*10.0)
+     boxsize(3) = dble(box(9)*10.0)
+
+     do j = 1, nreplica
+        do i = 1, numat
+           k = molid(1) + i - 1
+           cm = dble(xt(3*k-2:3*k,j)*10.0)
+           if (i == 1) then
+              x0(:,i) = cm
+           else
+              cm = cm - x0(:,i-1)
+              do l = 1, 3
+                 cm(l) = cm(l) - boxsize(l)*ANINT(cm(l)/boxsize(l))
+              end do
+              x0(:,i) = x0(:,i-1) + cm
+           end if
+        end do
+
+        H_Dihedral = 0
+        do i = 1, numat-4
+           Dihedral = ComputeDihedral(x0(:,i),x0(:,i+1),x0(:,i+2),x0(:,i+3))
+           Dihedral2 = ComputeDihedral(x0(:,i+1),x0(:,i+2),x0(:,i+3),x0(:,i+4))
+           r14 = sqrt(dot_product(x0(:,i)-x0(:,i+4),x0(:,i)-x0(:,i+4)))
+           helical = .TRUE.
+           do k = 1, ndihedrange
+              if (Dihedral < dihedrange(1,k) .or. Dihedral > dihedrange(2,k)) helical = .FALSE.
+              if (Dihedral2 < dihedrange(1,k) .or. Dihedral2 > dihedrange(2,k)) helical = .FALSE.
+           end do
+           if (r14 < r14range(1) .or. r14 > r14range(2)) helical = .FALSE.
+           if (helical) then
+              H_Dihedral(i) = 1
+              H_Dihedral(i+4) = 1
+           end if
+        end do
+
+        HelixPart = .FALSE.
+        do i = 1, numat-nneighbor+1
+           if (sum(H_Dihedral(i:i+nneighbor-1)) == nneighbor) then
+              do k = 1, nneighbor
+                 if (hhh(k) == 1) HelixPart(i+k-1) = .TRUE.
+              end do
+           end if
+        end do
+
+        do l = 1, ntarget
+           wall(l) = wall(l) + wgt(j,n,l)
+           if (ib <= nblock) wsum(ib,l) = wsum(ib,l) + wgt(j,n,l)
+           do i = 1, numat
+              if (.not. HelixPart(i)) cycle
+              hall(i,l) = hall(i,l) + wgt(j,n,l)
+              if (ib <= nblock) hsum(i,ib,l) = hsum(i,ib,l) + wgt(j,n,l)
+           end do
+        end do
+     end do
+  end do outer2
+
+  do i = 1, nreplica
+     call xdrfclose(sd(i), ierr)
+  end do
+
+! one line per residue: i, then mean and block std for each target T
+  open(10, file=trim(outfile), status='unknown', iostat=ierr)
+  if (ierr /= 0) stop 'Cannot open the outfile!'
+  do i = 1, numat
+     write(10,'(i6)',advance='no') i
+     do l = 1, ntarget
+        xave = hall(i,l)/wall(l)
+        xstd = 0.0
+        do ib = 1, nblock
+           hblk(ib) = 0.d0
+           if (wsum(ib,l) > 0.d0) hblk(ib) = hsum(i,ib,l)/wsum(ib,l)
+           xstd = xstd + (hblk(ib) - xave)**2
+        end do
+        xstd = sqrt(xstd/dble(nblock))
+        write(10,'(2f12.6)',advance='no') xave, xstd
+     end do
+     write(10,*)
+  end do
+  close(10)
+
+contains
+
+  subroutine print_usage()
+
+    implicit none
+
+    write (0, '(a)') "Usage: helixreweight OPTIONS"
+    write (0, '(a)') "       OPTIONS:::"
+    write (0, '(a)') "       -x(-xtc): file listing the xtc file of each walker"
+    write (0, '(a)') "       -en(-energy): energy file (step U_1 ... U_n)"
+    write (0, '(a)') "       -n(-ndx): ndx file (temperature index of each walker)"
+    write (0, '(a)') "       -temp: replica temperatures T_1 ... T_n"
+    write (0, '(a)') "       -target: target temperatures"
+    write (0, '(a)') "       -o(-out): output file"
+    write (0, '(a)') "       -dihed(-dihedral): dihedral angle range"
+    write (0, '(a)') "       -r14: r14 distance range"
+    write (0, '(a)') "       -nn(-nneighbor): number of neighboring residues and pattern"
+    write (0, '(a)') "       -m(-mol): molecule id (start end)"
+    write (0, '(a)') "       -e(-eq): equilibration step"
+    write (0, '(a)') "       -block: number of blocks"
+    write (0, '(a)') "       -h(-help): help"
+
+  end subroutine print_usage
+
+  function ComputeDihedral(x1, x2, x3, x4) result(d)
+
+    implicit none
+
+    real(8), intent(in) :: x1(3), x2(3), x3(3), x4(3)
+    real(8) :: d
+    real(8) :: b1(3), b2(3), b3(3), n1(3), n2(3), m(3)
+    real(8) :: r, x, y
+
+    b1 = x2 - x1
+    b2 = x2 - x3
+    b3 = x4 - x3
+
+    call CrossProduct(b1,b2,n1)
+    call CrossProduct(b2,b3,n2)
+    call CrossProduct(n1,b2,m)
+
+    r = sqrt(dot_product(n1,n1))
+    n1 = n1/r
+    r = sqrt(dot_product(n2,n2))
+    n2 = n2/r
+    r = sqrt(dot_product(m,m))
+    m = m/r
+
+    x = dot_product(n1,n2)
+    y = dot_product(m,n2)
+
+    d = atan2(y,x)
+
+  end function ComputeDihedral
+
+  subroutine CrossProduct(a, b, c)
+
+    implicit none
+
+    real(8), intent(in) :: a(3), b(3)
+    real(8), intent(out) :: c(3)
+
+    c(1) = a(2)*b(3) - a(3)*b(2)
+    c(2) = a(3)*b(1) - a(1)*b(3)
+    c(3) = a(1)*b(2) - a(2)*b(1)
+
+  end subroutine CrossProduct
+
+  integer function NumberColumn(filename)
+
+    implicit none
+
+    character (len=*), intent(in) :: filename
+    character (len=255) :: line, string
+    integer :: i
+
+    NumberColumn = 0
+    open(10, file=trim(filename), status='old', iostat=ierr)
+    if (ierr /= 0) stop 'Cannot open the file!'
+    read(10, '(a)') line
+    i = 1
+    call read_lineblock(i, line, string)
+    do while (len_trim(string) > 0)
+       NumberColumn = NumberColumn + 1
+       call read_lineblock(i, line, string)
+    end do
+    close(10)
+
+  end function NumberColumn
+
+  integer function NumberRow(filename)
+
+    implicit none
+
+    character (len=*), intent(in) :: filename
+    character (len=255) :: line
+    integer :: ierr
+
+    open(10, file=trim(filename), status='old', iostat=ierr)
+    if (ierr /= 0) stop 'Cannot open the file!'
+    NumberRow = 0
+    do while (ierr == 0)
+       read(10, '(a)', iostat=ierr) line
+       if (ierr == 0 .and. len_trim(line) > 0) NumberRow = NumberRow + 1
+    end do
+    close(10)
+
+  end function NumberRow
+
+  subroutine read_lineblock(i, line, bl)
+
+    implicit none
+
+    integer, intent(inout) :: i
+    character (len=*), intent(in) :: line
+    character (len=*), intent(out) :: bl
+    integer :: i1, i2
+
+    bl = ''
+
+    i1 = i
+    do while (line(i1:i1) == ' ' .and. i1 <= len_trim(line))
+       i1 = i1 + 1
+    end do
+    i2 = i1
+    do while (line(i2:i2) /= ' ' .and. i2 <= len_trim(line))
+       i2 = i2 + 1
+    end do
+    read (line(i1:i2), '(a)') bl
+    i = i2
+
+  end subroutine read_lineblock
+
+end program main
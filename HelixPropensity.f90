@@ -6,18 +6,20 @@ program main
 
   integer, parameter :: MAXFRAME = 2000000000
   character (len=255) :: infile, outfile, ndxfile, pdbfile, line
+  character (len=255) :: wfile, bfile
   character (len=255), allocatable :: xtcfile(:)
   integer, allocatable :: indxrep(:,:), idstep(:), indx(:)
   integer, allocatable :: sd(:), step(:)
   integer :: narg, ndihedrange, i, j, k, l, ii, jj
   integer :: imc, ndim, idrep, nreplica, ncomplex
+  real(8) :: wcomplex
   integer :: molid(2), hassign(4), nneighbor, numat, natom, magic, ierr, neq, ntot
   integer :: nrow, idr, idn, idi, NMC, nmcwrt, nblock, ntot_block, nn1, nn2
   character (len=80), allocatable :: ARGM(:)
   integer :: nrestype, rngseed, numconf
   character(len=3), dimension(:), allocatable :: restype, restypetmp
   integer, dimension(:), allocatable :: idres
-  integer, dimension(:,:), allocatable :: Nw, Nv
+  real(8), dimension(:,:), allocatable :: Nw, Nv
   character(len=3) :: aa
   real(8), dimension(:,:), allocatable :: lnw, lnv
   real(8), dimension(:), allocatable :: wave, vave, wstd, vstd
@@ -34,6 +36,10 @@ program main
   logical, allocatable :: HelixPart(:)
   real(8), dimension(:), allocatable :: hfrac
   real(8), dimension(:,:), allocatable :: hfracsim
+  integer :: nwrow, idw
+  integer, allocatable :: wstep(:)
+  real(8), allocatable :: wframe(:), wblock(:)
+  real(8) :: wgt, wtemp
   real(8), parameter :: dv = 0.1d0
   real(8), parameter :: dw = 0.1d0
   real(8), parameter :: lwmax = 10.d0
@@ -58,6 +64,9 @@ program main
      outfile = ''
      ndxfile = ''
      pdbfile = ''
+     wfile = ''
+     bfile = ''
+     wtemp = 0.d0
      idrep = 0
      molid = 0
      hassign = 0
@@ -125,6 +134,13 @@ program main
         case ('-nmc')
            read(ARGM(i+1),*,iostat=ierr) NMC
            if (ierr /= 0) stop 'Invalid entry in -nmc option!'
+        case ('-w','-weight')
+           wfile = trim(ARGM(i+1))
+        case ('-bias')
+           bfile = trim(ARGM(i+1))
+        case ('-temp')
+           read(ARGM(i+1),*,iostat=ierr) wtemp
+           if (ierr /= 0) stop 'Invalid entry in -temp option!'
         case ('-block')
            read(ARGM(i+1),*,iostat=ierr) nblock
            if (ierr /= 0) stop 'Invalid entry in -block option!'
@@ -138,6 +154,13 @@ program main
   if (rngseed < 1) stop 'Wrong RNG seed!'
   if (nblock < 1) nblock = 1
 
+! per-frame weights of biased or reweighted runs
+  nwrow = 0
+  if (len_trim(wfile) > 0 .or. len_trim(bfile) > 0) then
+     call ReadWeights(wfile, bfile, wtemp, nwrow, wstep, wframe)
+     write(0,*) 'Number of weighted frames = ', nwrow
+  end if
+
 ! determine the number of replicas
   if (len_trim(ndxfile) > 0) then
      nreplica = NumberColumn(ndxfile) - 1
@@ -272,12 +295,15 @@ program main
 
   allocate(Nw(numconf,nblock+1))
   allocate(Nv(numconf,nblock+1))
-  Nw = 0
-  Nv = 0
+  Nw = 0.d0
+  Nv = 0.d0
+  allocate(wblock(nblock+1))
   hfracsim = 0.d0
+  wblock = 0.d0
 
   ntot = 0 
   idi = 1
+  idw = 1
   outer: do imc = 1, MAXFRAME
      do i = 1, nreplica
         call readxtc(sd(i), natom, step(i), time, box, xt(:,i), prec, ierr)
@@ -305,6 +331,19 @@ program main
         else
            idr = 1
         end if
+        wgt = 1.d0
+        if (nwrow > 0) then
+           idn = 0
+           do i = idw, nwrow
+              if (wstep(i) == step(1)) then
+                 idn = i
+                 exit
+              end if
+           end do
+           if (idn == 0) stop 'Step missing in the weight file!'
+           idw = idn
+           wgt = wframe(idn)
+        end if
         boxsize(1) = dble(box(1)*10.0)
         boxsize(2) = dble(box(5)*10.0)
         boxsize(3) = dble(box(9)*10.0)
@@ -355,19 +394,20 @@ program main
 !           end if
 !        end do
         do i = 1, numat
-           if (HelixPart(i)) hfracsim(i,j) = hfracsim(i,j) + 1.d0
+           if (HelixPart(i)) hfracsim(i,j) = hfracsim(i,j) + wgt
         end do
+        wblock(j) = wblock(j) + wgt
 
         if (j <= nblock) then
            do i = 1, numat
               if (HelixPart(i)) then
                  if (i == 1 .or. i == numat) then  !  end residues; weight = v
-                    Nv(idconf(i),j) = Nv(idconf(i),j) + 1
+                    Nv(idconf(i),j) = Nv(idconf(i),j) + wgt
                  else
                     if (Helixpart(i-1) .and. HelixPart(i+1)) then ! helix segment; weight = w
-                       Nw(idconf(i),j) = Nw(idconf(i),j) + 1
+                       Nw(idconf(i),j) = Nw(idconf(i),j) + wgt
                     else
-                       Nv(idconf(i),j) = Nv(idconf(i),j) + 1
+                       Nv(idconf(i),j) = Nv(idconf(i),j) + wgt
                     end if
                  end if
               end if
@@ -375,10 +415,23 @@ program main
         end if
      end if
   end do outer
+! scale the weights to mean 1, the counts keep the scale of an unweighted run
+  if (sum(wblock(1:nblock)) > 0.d0) then
+     wgt = dble(ntot_block*nblock)/sum(wblock(1:nblock))
+     Nw = Nw*wgt
+     Nv = Nv*wgt
+     hfracsim = hfracsim*wgt
+     wblock = wblock*wgt
+  end if
   Nw(:,nblock+1) = sum(Nw(:,1:nblock),dim=2)
   Nv(:,nblock+1) = sum(Nv(:,1:nblock),dim=2)
-  hfracsim(:,1:nblock) = hfracsim(:,1:nblock)/dble(ntot_block)
-  hfracsim(:,nblock+1) = sum(hfracsim(:,1:nblock),dim=2)/dble(nblock)
+! weighted ensemble average over all blocks, then the mean of each block
+  hfracsim(:,nblock+1) = 0.d0
+  if (sum(wblock(1:nblock)) > 0.d0) &
+     hfracsim(:,nblock+1) = sum(hfracsim(:,1:nblock),dim=2)/sum(wblock(1:nblock))
+  do j = 1, nblock
+     if (wblock(j) > 0.d0) hfracsim(:,j) = hfracsim(:,j)/wblock(j)
+  end do
 
   do i = 1, nreplica
      call xdrfclose(sd(i), ierr)
@@ -399,11 +452,11 @@ program main
   do j = 1, nblock+1
      write(0,*) "Block = ", j
      if (j <= nblock) then
-        ncomplex = ntot_block
+        wcomplex = wblock(j)
      else
-        ncomplex = ntot_block*nblock
+        wcomplex = sum(wblock(1:nblock))
      end if
-     kSpr = dble(ncomplex)*10.d0
+     kSpr = wcomplex*10.d0
 
      do ii = 1, Ncol
 
@@ -412,7 +465,7 @@ program main
            lnvcol(i,ii) = 2.d0*(grnd() - 0.5d0)
         end do
 
-        lnL = LogLikelihood(ncomplex,numat,numconf,Nv(:,j),Nw(:,j), &
+        lnL = LogLikelihood(wcomplex,numat,numconf,Nv(:,j),Nw(:,j), &
            lnvcol(:,ii),lnwcol(:,ii),idconf)
 
         do imc = 1, NMC
@@ -423,7 +476,7 @@ program main
            lnwcol(i,ii) = lnwcol(i,ii) + dw*(grnd() - 0.5d0)
            if (lnwcol(i,ii) > lwmax) lnwcol(i,ii) = 2.d0*lwmax - lnwcol(i,ii)
            if (lnwcol(i,ii) < lwmin) lnwcol(i,ii) = 2.d0*lwmin - lnwcol(i,ii)
-           lnL_new = LogLikelihood(ncomplex,numat,numconf,Nv(:,j),Nw(:,j), &
+           lnL_new = LogLikelihood(wcomplex,numat,numconf,Nv(:,j),Nw(:,j), &
                lnvcol(:,ii),lnwcol(:,ii),idconf)
            if (lnL_new > lnL) then
               lnL = lnL_new
@@ -439,7 +492,7 @@ program main
            lnvcol(i,ii) = lnvcol(i,ii) + dv*(grnd() - 0.5d0)
            if (lnvcol(i,ii) > lvmax) lnvcol(i,ii) = 2.d0*lvmax - lnvcol(i,ii)
            if (lnvcol(i,ii) < lvmin) lnvcol(i,ii) = 2.d0*lvmin - lnvcol(i,ii)
-           lnL_new = LogLikelihood(ncomplex,numat,numconf,Nv(:,j),Nw(:,j), &
+           lnL_new = LogLikelihood(wcomplex,numat,numconf,Nv(:,j),Nw(:,j), &
               lnvcol(:,ii),lnwcol(:,ii),idconf)
            if (lnL_new > lnL) then
               lnL = lnL_new
@@ -460,7 +513,7 @@ program main
            lnwcol(i,ii) = lnwcol(i,ii) + 0.2*dw*(grnd() - 0.5d0)
            if (lnwcol(i,ii) > lwmax) lnwcol(i,ii) = 2.d0*lwmax - lnwcol(i,ii)
            if (lnwcol(i,ii) < lwmin) lnwcol(i,ii) = 2.d0*lwmin - lnwcol(i,ii)
-           lnL_new = LogLikelihood(ncomplex,numat,numconf,Nv(:,j),Nw(:,j), &
+           lnL_new = LogLikelihood(wcomplex,numat,numconf,Nv(:,j),Nw(:,j), &
               lnvcol(:,ii),lnwcol(:,ii),idconf)
            if (lnL_new > lnL) then
               lnL = lnL_new
@@ -474,7 +527,7 @@ program main
            lnvcol(i,ii) = lnvcol(i,ii) + 0.2*dv*(grnd() - 0.5d0)
            if (lnvcol(i,ii) > lvmax) lnvcol(i,ii) = 2.d0*lvmax - lnvcol(i,ii)
            if (lnvcol(i,ii) < lvmin) lnvcol(i,ii) = 2.d0*lvmin - lnvcol(i,ii)
-           lnL_new = LogLikelihood(ncomplex,numat,numconf,Nv(:,j),Nw(:,j), &
+           lnL_new = LogLikelihood(wcomplex,numat,numconf,Nv(:,j),Nw(:,j), &
               lnvcol(:,ii),lnwcol(:,ii),idconf)
            if (lnL_new > lnL) then
               lnL = lnL_new
@@ -542,10 +595,81 @@ contains
     write (0, '(a)') "       -s(-seed): RNG seed"
     write (0, '(a)') "       -nmc: number of MC steps"
     write (0, '(a)') "       -block: number of blocks"
+    write (0, '(a)') "       -w(-weight): per-frame weights (step weight)"
+    write (0, '(a)') "       -bias: bias energy in kcal/mol (step V), weight = exp(V/kT)"
+    write (0, '(a)') "              static bias only; metadynamics: step V c(t), weight = exp((V-c(t))/kT)"
+    write (0, '(a)') "       -temp: temperature of the biased run (K)"
     write (0, '(a)') "       -h(-help): help"
 
   end subroutine print_usage
 
+  subroutine ReadWeights(wfile, bfile, temp, n, wstep, wframe)
+
+! per-frame weights (step weight) and/or a bias energy (step V in kcal/mol)
+! converted to exp(V/kT); both files must list the same steps
+! exp(V/kT) holds for a static bias only; for metadynamics the bias file
+! has a third column c(t), the time-dependent offset of the bias (e.g. the
+! rct of PLUMED), and the weight is exp((V - c(t))/kT)
+
+    implicit none
+
+    character(len=*), intent(in) :: wfile, bfile
+    real(8), intent(in) :: temp
+    integer, intent(out) :: n
+    integer, allocatable, intent(out) :: wstep(:)
+    real(8), allocatable, intent(out) :: wframe(:)
+    real(8), parameter :: KB = 0.0019872041d0   ! kcal/mol/K
+    real(8), allocatable :: vbias(:)
+    integer :: i, ierr, nb, s, nc
+    real(8) :: ct
+
+    n = 0
+    if (len_trim(wfile) > 0) then
+       n = NumberRow(wfile)
+       allocate(wstep(n), wframe(n))
+       open(11, file=trim(wfile), status='old', iostat=ierr)
+       if (ierr /= 0) stop 'Cannot open the weight file!'
+       do i = 1, n
+          read(11,*,iostat=ierr) wstep(i), wframe(i)
+          if (ierr /= 0) stop 'Invalid entry in the weight file!'
+          if (wframe(i) < 0.d0) stop 'Negative entry in the weight file!'
+       end do
+       close(11)
+    end if
+
+    if (len_trim(bfile) > 0) then
+       if (temp <= 0.d0) stop 'Invalid entry in -temp option!'
+       nb = NumberRow(bfile)
+       if (n == 0) then
+          n = nb
+          allocate(wstep(n), wframe(n))
+          wframe = 1.d0
+       else if (nb /= n) then
+          stop 'Weight and bias files differ in length!'
+       end if
+       allocate(vbias(n))
+       nc = NumberColumn(bfile)
+       open(11, file=trim(bfile), status='old', iostat=ierr)
+       if (ierr /= 0) stop 'Cannot open the bias file!'
+       do i = 1, n
+          if (nc >= 3) then
+             read(11,*,iostat=ierr) s, vbias(i), ct
+             vbias(i) = vbias(i) - ct
+          else
+             read(11,*,iostat=ierr) s, vbias(i)
+          end if
+          if (ierr /= 0) stop 'Invalid entry in the bias file!'
+          if (len_trim(wfile) > 0 .and. s /= wstep(i)) stop 'Weight and bias steps mismatch!'
+          wstep(i) = s
+       end do
+       close(11)
+! shift by the largest bias, only ratios of weights matter
+       wframe = wframe*exp((vbias - maxval(vbias))/(KB*temp))
+       deallocate(vbias)
+    end if
+
+  end subroutine ReadWeights
+
   function HelixFraction(n, m, w, v, id, i) result(h)
 
     implicit none
@@ -623,8 +747,9 @@ contains
 
     implicit none
 
-    integer, intent(in) :: nc, n, m
-    integer, dimension(m), intent(in) :: nv, nw
+    real(8), intent(in) :: nc
+    integer, intent(in) :: n, m
+    real(8), dimension(m), intent(in) :: nv, nw
     real(8), dimension(m), intent(in) :: lv, lw
     integer, dimension(n), intent(in) :: id
     real(8) :: y
@@ -664,9 +789,9 @@ contains
     x = matmul(x1,matmul(Mtot,x2))
     lnZ = log(x(1,1))
 
-    y = - dble(nc)*lnZ
+    y = - nc*lnZ
     do i = 1, m
-       y = y + dble(nv(i))*lv(i) + dble(nw(i))*lw(i)
+       y = y + nv(i)*lv(i) + nw(i)*lw(i)
     end do
 
   end function LogLikelihood
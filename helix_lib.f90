@@ -0,0 +1,361 @@
+! Shared library of the helix assignment rules of HelixFracDihed15.f90 /
+! HelixPropensity.f90 and the Lifson-Roig transfer matrix routines, callable
+! from C or Python (hpsss_tools/helixlib.py).
+!
+! Arrays are in C order and never copied: coordinates [frames,N,3] are
+! x(3,N,frames) here, box [frames,3] is box(3,frames) (0 = not periodic),
+! helix assignments [frames,N] are int8 part(N,frames).  Conformation ids
+! idconf are 0-based.  Frames (and parameter sets) are split over OpenMP
+! threads.
+!
+! To compile:
+!   ifort -qopenmp -fPIC -shared -o libhelix.so helix_lib.f90
+!   gfortran -O2 -fopenmp -fPIC -shared -o libhelix.so helix_lib.f90
+
+module helix_lib
+
+  use iso_c_binding
+  !$ use omp_lib
+
+  implicit none
+
+contains
+
+  subroutine hl_set_threads(n) bind(C, name='hl_set_threads')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: n
+
+    !$ if (n > 0) call omp_set_num_threads(n)
+
+  end subroutine hl_set_threads
+
+!   dihedrals (i,i+1,i+2,i+3) of every frame, phi [frames,N-3]
+
+  subroutine hl_dihedrals(nframe, natom, x, box, phi) bind(C, name='hl_dihedrals')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: nframe, natom
+    real(c_double), intent(in) :: x(3,natom,nframe), box(3,nframe)
+    real(c_double), intent(out) :: phi(max(natom-3,0),nframe)
+    real(8) :: x0(3,natom)
+    integer :: k, i
+
+    !$omp parallel do default(shared) private(k,i,x0)
+    do k = 1, nframe
+       call Unwrap(natom, x(:,:,k), box(:,k), x0)
+       do i = 1, natom-3
+          phi(i,k) = ComputeDihedral(x0(:,i),x0(:,i+1),x0(:,i+2),x0(:,i+3))
+       end do
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_dihedrals
+
+!   (i,i+4) rule of HelixFracDihed15: contact (i,i+4) is helical if the
+!   dihedrals (i..i+3) and (i+1..i+4) are inside every -dihed range and
+!   r14 inside -r14; residues i and i+4 are then helical.  With -nn n hhh,
+!   residue i+j-1 is part of a helix if hhh(j) = 1 and residues i..i+n-1
+!   are all helical.
+
+  subroutine hl_assign_i4(nframe, natom, x, box, ndihedrange, dihedrange, &
+       r14range, nneighbor, hhh, part) bind(C, name='hl_assign_i4')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: nframe, natom, ndihedrange, nneighbor
+    real(c_double), intent(in) :: x(3,natom,nframe), box(3,nframe)
+    real(c_double), intent(in) :: dihedrange(2,ndihedrange), r14range(2)
+    integer(c_int), intent(in) :: hhh(nneighbor)
+    integer(c_int8_t), intent(out) :: part(natom,nframe)
+    real(8) :: x0(3,natom), Dihedral, Dihedral2, r14
+    integer :: H_Dihedral(natom)
+    integer :: k, i, j
+    logical :: helical
+
+    !$omp parallel do default(shared) &
+    !$omp private(k,i,j,x0,Dihedral,Dihedral2,r14,H_Dihedral,helical)
+    do k = 1, nframe
+       call Unwrap(natom, x(:,:,k), box(:,k), x0)
+
+       H_Dihedral = 0
+       do i = 1, natom-4
+          Dihedral = ComputeDihedral(x0(:,i),x0(:,i+1),x0(:,i+2),x0(:,i+3))
+          Dihedral2 = ComputeDihedral(x0(:,i+1),x0(:,i+2),x0(:,i+3),x0(:,i+4))
+          r14 = sqrt(dot_product(x0(:,i)-x0(:,i+4),x0(:,i)-x0(:,i+4)))
+          helical = .TRUE.
+          do j = 1, ndihedrange
+             if (Dihedral < dihedrange(1,j) .or. Dihedral > dihedrange(2,j)) helical = .FALSE.
+             if (Dihedral2 < dihedrange(1,j) .or. Dihedral2 > dihedrange(2,j)) helical = .FALSE.
+          end do
+          if (r14 < r14range(1) .or. r14 > r14range(2)) helical = .FALSE.
+          if (helical) then
+             H_Dihedral(i) = 1
+             H_Dihedral(i+4) = 1
+          end if
+       end do
+
+       part(:,k) = 0
+       do i = 1, natom-nneighbor+1
+          if (sum(H_Dihedral(i:i+nneighbor-1)) == nneighbor) then
+             do j = 1, nneighbor
+                if (hhh(j) == 1) part(i+j-1,k) = 1
+             end do
+          end if
+       end do
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_assign_i4
+
+!   (i+1,i+2) rule of HelixPropensity: if dihedral (i..i+3) is inside every
+!   -dihed range and r(i,i+3) inside -r14, residues i+j-1 with -assign
+!   hassign(j) = 1 are helical.  Residue i is part of a helix if residues
+!   i-nn..i+nn (inside the chain) are all helical.
+
+  subroutine hl_assign_i12(nframe, natom, x, box, ndihedrange, dihedrange, &
+       r14range, hassign, nneighbor, part) bind(C, name='hl_assign_i12')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: nframe, natom, ndihedrange, nneighbor
+    real(c_double), intent(in) :: x(3,natom,nframe), box(3,nframe)
+    real(c_double), intent(in) :: dihedrange(2,ndihedrange), r14range(2)
+    integer(c_int), intent(in) :: hassign(4)
+    integer(c_int8_t), intent(out) :: part(natom,nframe)
+    real(8) :: x0(3,natom), Dihedral, r14
+    integer :: H_Dihedral(natom)
+    integer :: k, i, j
+    logical :: helical
+
+    !$omp parallel do default(shared) &
+    !$omp private(k,i,j,x0,Dihedral,r14,H_Dihedral,helical)
+    do k = 1, nframe
+       call Unwrap(natom, x(:,:,k), box(:,k), x0)
+
+       H_Dihedral = 0
+       do i = 1, natom-3
+          Dihedral = ComputeDihedral(x0(:,i),x0(:,i+1),x0(:,i+2),x0(:,i+3))
+          r14 = sqrt(dot_product(x0(:,i)-x0(:,i+3),x0(:,i)-x0(:,i+3)))
+          helical = .TRUE.
+          do j = 1, ndihedrange
+             if (Dihedral < dihedrange(1,j) .or. Dihedral > dihedrange(2,j)) helical = .FALSE.
+          end do
+          if (r14 < r14range(1) .or. r14 > r14range(2)) helical = .FALSE.
+          if (helical) then
+             do j = 1, 4
+                if (hassign(j) == 1) H_Dihedral(i+j-1) = 1
+             end do
+          end if
+       end do
+
+       part(:,k) = 1
+       do i = 1, natom
+          do j = max(1,i-nneighbor), min(natom,i+nneighbor)
+             if (H_Dihedral(j) == 0) part(i,k) = 0
+          end do
+       end do
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_assign_i12
+
+!   weighted helix counts of HelixPropensity, added to hsum(N), nv(m) and
+!   nw(m): a helical residue counts for w if both neighbors are helical
+!   (inner residues only), otherwise for v
+
+  subroutine hl_counts(nframe, natom, part, nconf, idconf, wgt, hsum, nv, nw) &
+       bind(C, name='hl_counts')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: nframe, natom, nconf
+    integer(c_int8_t), intent(in) :: part(natom,nframe)
+    integer(c_int), intent(in) :: idconf(natom)
+    real(c_double), intent(in) :: wgt(nframe)
+    real(c_double), intent(inout) :: hsum(natom), nv(nconf), nw(nconf)
+    integer :: k, i, ic
+
+    !$omp parallel do default(shared) private(k,i,ic) reduction(+:hsum,nv,nw)
+    do k = 1, nframe
+       do i = 1, natom
+          if (part(i,k) == 0) cycle
+          hsum(i) = hsum(i) + wgt(k)
+          ic = idconf(i) + 1
+          if (i == 1 .or. i == natom) then
+             nv(ic) = nv(ic) + wgt(k)
+          else if (part(i-1,k) /= 0 .and. part(i+1,k) /= 0) then
+             nw(ic) = nw(ic) + wgt(k)
+          else
+             nv(ic) = nv(ic) + wgt(k)
+          end if
+       end do
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_counts
+
+!   Lifson-Roig helix fraction of every residue, h(N), for w(m), v(m)
+
+  subroutine hl_helix_fraction(n, m, w, v, idconf, h) bind(C, name='hl_helix_fraction')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: n, m
+    real(c_double), intent(in) :: w(m), v(m)
+    integer(c_int), intent(in) :: idconf(n)
+    real(c_double), intent(out) :: h(n)
+    real(8) :: z
+    integer :: i
+
+    z = PartitionFunction(n, m, w, v, idconf, 0)
+
+    !$omp parallel do default(shared) private(i)
+    do i = 1, n
+       h(i) = PartitionFunction(n, m, w, v, idconf, i)/z
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_helix_fraction
+
+!   LogLikelihood of HelixPropensity for nset parameter sets lv(m,nset),
+!   lw(m,nset) (ln v, ln w); nc = (weighted) number of frames
+
+  subroutine hl_log_likelihood(nset, nc, n, m, nv, nw, lv, lw, idconf, y) &
+       bind(C, name='hl_log_likelihood')
+
+    implicit none
+
+    integer(c_int), value, intent(in) :: nset, n, m
+    real(c_double), value, intent(in) :: nc
+    real(c_double), intent(in) :: nv(m), nw(m)
+    real(c_double), intent(in) :: lv(m,nset), lw(m,nset)
+    integer(c_int), intent(in) :: idconf(n)
+    real(c_double), intent(out) :: y(nset)
+    integer :: k
+
+    !$omp parallel do default(shared) private(k)
+    do k = 1, nset
+       y(k) = - nc*log(PartitionFunction(n, m, exp(lw(:,k)), exp(lv(:,k)), idconf, 0)) &
+          + dot_product(nv,lv(:,k)) + dot_product(nw,lw(:,k))
+    end do
+    !$omp end parallel do
+
+  end subroutine hl_log_likelihood
+
+!   product of the Lifson-Roig matrices of residues 1..n between the end
+!   vectors, as in HelixFraction/LogLikelihood of HelixPropensity; residue
+!   i (if > 0) is restricted to the helical state w
+
+  function PartitionFunction(n, m, w, v, id, i) result(z)
+
+    implicit none
+
+    integer, intent(in) :: n, m, i
+    real(8), intent(in) :: w(m), v(m)
+    integer(c_int), intent(in) :: id(n)
+    real(8) :: z
+    real(8), dimension(3,3) :: Mtot, M1
+    real(8), dimension(1,3) :: x1
+    real(8), dimension(3,1) :: x2
+    real(8), dimension(1,1) :: xx
+    integer :: k
+
+    Mtot = 0.d0
+    Mtot(1,1) = 1.d0
+    Mtot(2,2) = 1.d0
+    Mtot(3,3) = 1.d0
+    do k = 1, n
+       M1 = 0.d0
+       M1(1,1) = w(id(k)+1)
+       if (k /= i) then
+          M1(1,2) = v(id(k)+1)
+          M1(2,3) = 1.d0
+          M1(3,1) = v(id(k)+1)
+          M1(3,2) = v(id(k)+1)
+          M1(3,3) = 1.d0
+       end if
+       Mtot = matmul(Mtot,M1)
+    end do
+
+    x1 = 0.d0
+    x1(1,3) = 1.d0
+    x2 = 1.d0
+    x2(1,1) = 0.d0
+
+    xx = matmul(x1,matmul(Mtot,x2))
+    z = xx(1,1)
+
+  end function PartitionFunction
+
+!   chain made whole bond by bond with the minimum image, as in the tools
+
+  subroutine Unwrap(natom, x, box, x0)
+
+    implicit none
+
+    integer, intent(in) :: natom
+    real(8), intent(in) :: x(3,natom), box(3)
+    real(8), intent(out) :: x0(3,natom)
+    real(8) :: cm(3)
+    integer :: i, j
+
+    if (natom < 1) return
+    x0(:,1) = x(:,1)
+    do i = 2, natom
+       cm = x(:,i) - x0(:,i-1)
+       do j = 1, 3
+          if (box(j) > 0.d0) cm(j) = cm(j) - box(j)*ANINT(cm(j)/box(j))
+       end do
+       x0(:,i) = x0(:,i-1) + cm
+    end do
+
+  end subroutine Unwrap
+
+  function ComputeDihedral(x1, x2, x3, x4) result(d)
+
+    implicit none
+
+    real(8), intent(in) :: x1(3), x2(3), x3(3), x4(3)
+    real(8) :: d
+    real(8) :: b1(3), b2(3), b3(3), n1(3), n2(3), m(3)
+    real(8) :: r, x, y
+
+    b1 = x2 - x1
+    b2 = x2 - x3
+    b3 = x4 - x3
+
+    call CrossProduct(b1,b2,n1)
+    call CrossProduct(b2,b3,n2)
+    call CrossProduct(n1,b2,m)
+
+    r = sqrt(dot_product(n1,n1))
+    n1 = n1/r
+    r = sqrt(dot_product(n2,n2))
+    n2 = n2/r
+    r = sqrt(dot_product(m,m))
+    m = m/r
+
+    x = dot_product(n1,n2)
+    y = dot_product(m,n2)
+
+    d = atan2(y,x)
+
+  end function ComputeDihedral
+
+  subroutine CrossProduct(a, b, c)
+
+    implicit none
+
+    real(8), intent(in) :: a(3), b(3)
+    real(8), intent(out) :: c(3)
+
+    c(1) = a(2)*b(3) - a(3)*b(2)
+    c(2) = a(3)*b(1) - a(1)*b(3)
+    c(3) = a(1)*b(2) - a(2)*b(1)
+
+  end subroutine CrossProduct
+
+end module helix_lib
@@ -0,0 +1,261 @@
+"""Build a multi-chain HPS-SS data file from sequence files.
+
+Chains are grown as self-avoiding random walks with the 3.8 A bond (in parallel),
+then placed one by one with a random rotation into the box or a slab, rejecting
+any placement that comes closer than --dmin to an atom already in the box
+(cell list, minimum image).  Writes a LAMMPS data file (atom_style full) and an
+include file with the bond/angle/dihedral/pair coefficients.
+
+usage:
+  python3 gen_condensate.py -s fus.dat 100 -s tdp43.dat 50 --box 150 150 1000 \
+      --slab -75 75 -o in.data -c in.coeffs
+"""
+import argparse
+import math
+import multiprocessing
+import os
+import random
+import sys
+
+import hpsss_topology as hps
+
+
+def random_unit(rng):
+    z = 2.0*rng.random() - 1.0
+    phi = 2.0*math.pi*rng.random()
+    s = math.sqrt(1.0 - z*z)
+    return s*math.cos(phi), s*math.sin(phi), z
+
+
+def saw(args):
+    """Self-avoiding walk of n beads, centered at its center of mass."""
+    n, bond, dmin, seed = args
+    rng = random.Random(seed)
+    dmin2 = dmin*dmin
+    while True:
+        x = [(0.0, 0.0, 0.0)]
+        cells = {(0, 0, 0): [0]}
+        ok = True
+        for i in range(1, n):
+            for _ in range(200):
+                u = random_unit(rng)
+                p = tuple(x[-1][k] + bond*u[k] for k in range(3))
+                c = tuple(int(math.floor(p[k]/dmin)) for k in range(3))
+                clash = False
+                for dx in (-1, 0, 1):
+                    for dy in (-1, 0, 1):
+                        for dz in (-1, 0, 1):
+                            for j in cells.get((c[0]+dx, c[1]+dy, c[2]+dz), ()):
+                                if j == i - 1:
+                                    continue
+                                q = x[j]
+                                if (p[0]-q[0])**2 + (p[1]-q[1])**2 + (p[2]-q[2])**2 < dmin2:
+                                    clash = True
+                                    break
+                            if clash:
+                                break
+                        if clash:
+                            break
+                    if clash:
+                        break
+                if not clash:
+                    x.append(p)
+                    cells.setdefault(c, []).append(i)
+                    break
+            else:
+                ok = False
+                break
+        if ok:
+            break
+    com = [sum(p[k] for p in x)/n for k in range(3)]
+    return [tuple(p[k] - com[k] for k in range(3)) for p in x]
+
+
+def random_rotation(rng):
+    """Uniform random rotation matrix from a unit quaternion."""
+    u1, u2, u3 = rng.random(), rng.random(), rng.random()
+    a = math.sqrt(1.0 - u1)*math.sin(2.0*math.pi*u2)
+    b = math.sqrt(1.0 - u1)*math.cos(2.0*math.pi*u2)
+    c = math.sqrt(u1)*math.sin(2.0*math.pi*u3)
+    d = math.sqrt(u1)*math.cos(2.0*math.pi*u3)
+    return ((1-2*(c*c+d*d), 2*(b*c-a*d), 2*(b*d+a*c)),
+            (2*(b*c+a*d), 1-2*(b*b+d*d), 2*(c*d-a*b)),
+            (2*(b*d-a*c), 2*(c*d+a*b), 1-2*(b*b+c*c)))
+
+
+class Box:
+    """Periodic box centered at the origin with a cell list of placed atoms."""
+
+    def __init__(self, length, dmin):
+        self.lo = [-0.5*l for l in length]
+        self.length = length
+        self.dmin2 = dmin*dmin
+        self.ncell = [max(1, int(l/dmin)) for l in length]
+        self.cells = {}
+        self.x = []
+
+    def wrap(self, p):
+        w, img = [], []
+        for k in range(3):
+            n = math.floor((p[k] - self.lo[k])/self.length[k])
+            w.append(p[k] - n*self.length[k])
+            img.append(n)
+        return w, img
+
+    def cell(self, w):
+        return tuple(min(int((w[k] - self.lo[k])/self.length[k]*self.ncell[k]), self.ncell[k]-1)
+                     for k in range(3))
+
+    def clash(self, w, skip=-1):
+        c = self.cell(w)
+        seen = set()
+        for dx in (-1, 0, 1):
+            for dy in (-1, 0, 1):
+                for dz in (-1, 0, 1):
+                    key = ((c[0]+dx) % self.ncell[0], (c[1]+dy) % self.ncell[1],
+                           (c[2]+dz) % self.ncell[2])
+                    if key in seen:
+                        continue
+                    seen.add(key)
+                    for j in self.cells.get(key, ()):
+                        if j == skip:
+                            continue
+                        q = self.x[j]
+                        r2 = 0.0
+                        for k in range(3):
+                            d = w[k] - q[k]
+                            d -= self.length[k]*round(d/self.length[k])
+                            r2 += d*d
+                        if r2 < self.dmin2:
+                            return True
+        return False
+
+    def insert(self, conf, rot, com):
+        """Rotate + translate conf, insert if no clash.  Returns [(x, image)] or None.
+        Atoms are added as they are checked, so a chain longer than the box is also
+        checked against its own periodic images; a rejected chain is rolled back."""
+        first = len(self.x)
+        placed = []
+        for p in conf:
+            q = [com[k] + rot[k][0]*p[0] + rot[k][1]*p[1] + rot[k][2]*p[2] for k in range(3)]
+            w, img = self.wrap(q)
+            if self.clash(w, skip=len(self.x) - 1 if placed else -1):
+                for v, _ in placed:
+                    self.cells[self.cell(v)].pop()
+                del self.x[first:]
+                return None
+            self.cells.setdefault(self.cell(w), []).append(len(self.x))
+            self.x.append(w)
+            placed.append((w, img))
+        return placed
+
+
+def write_data(filename, top, box, coords, charges_on=True):
+    chains = top.chains
+    natoms = sum(len(c) for c in chains)
+    nbonds = sum(len(c) - 1 for c in chains)
+    nangles = sum(max(len(c) - 2, 0) for c in chains)
+    ndihedrals = sum(max(len(c) - 3, 0) for c in chains)
+
+    with open(filename, 'w') as fout:
+        fout.write(' LAMMPS data file for protein condensate\n \n')
+        fout.write(f'{natoms:12d}   atoms\n{nbonds:12d}   bonds\n')
+        fout.write(f'{nangles:12d}   angles\n{ndihedrals:12d}   dihedrals\n \n')
+        fout.write(f'{len(top.residues):12d}   atom types\n')
+        fout.write(f'{1:12d}   bond types\n{1:12d}   angle types\n')
+        fout.write(f'{len(top.dihedral_values):12d}   dihedral types\n \n')
+        for k, (a, b) in enumerate((('xlo', 'xhi'), ('ylo', 'yhi'), ('zlo', 'zhi'))):
+            lo = box.lo[k]
+            fout.write(f'  {lo:.6f}       {lo + box.length[k]:.6f}        {a} {b}\n')
+        fout.write(' \n Masses\n \n')
+        for res in top.residues:
+            fout.write(f'{top.atomtype[res]:12d}   {hps.mass[res]:.6f}\n')
+
+        fout.write(' \n Atoms\n \n')
+        n = 0
+        for m, chain in enumerate(chains):
+            for res, (w, img) in zip(chain, coords[m]):
+                n += 1
+                q = hps.charge.get(res, 0.0) if charges_on else 0.0
+                fout.write(f'{n:8d} {m+1:10d} {top.atomtype[res]:10d} {q:10.3f} '
+                           f'{w[0]:10.3f} {w[1]:10.3f} {w[2]:10.3f} {img[0]} {img[1]} {img[2]}\n')
+
+        sections = (('Bonds', 2), ('Angles', 3), ('Dihedrals', 4))
+        for name, nbody in sections:
+            fout.write(f' \n {name}\n \n')
+            n = first = 0
+            for m, chain in enumerate(chains):
+                for i in range(len(chain) - nbody + 1):
+                    n += 1
+                    itype = top.dihedral_types[m][i] if nbody == 4 else 1
+                    ids = ' '.join(f'{first + i + k + 1:10d}' for k in range(nbody))
+                    fout.write(f'{n:8d} {itype:10d} {ids}\n')
+                first += len(chain)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-s', '--seq', nargs=2, action='append', required=True,
+                        metavar=('FILE', 'N'), help='one-letter sequence file and number of copies')
+    parser.add_argument('--box', nargs=3, type=float, required=True, metavar=('LX', 'LY', 'LZ'))
+    parser.add_argument('--slab', nargs=2, type=float, metavar=('ZLO', 'ZHI'),
+                        help='restrict chain centers to zlo < z < zhi')
+    parser.add_argument('--dmin', type=float, default=4.0, help='min. non-bonded distance (A)')
+    parser.add_argument('--bond', type=float, default=hps.BOND[1])
+    parser.add_argument('--tries', type=int, default=2000, help='placement tries per conformation')
+    parser.add_argument('--nproc', type=int, default=os.cpu_count())
+    parser.add_argument('--seed', type=int, default=12345)
+    parser.add_argument('--epsd', help='eps_d table (default eps_d_i_i+4.txt)')
+    parser.add_argument('--per-dihedral', action='store_true',
+                        help='one dihedral type per dihedral instead of per eps_d value')
+    parser.add_argument('-o', '--out', default='in.data')
+    parser.add_argument('-c', '--coeffs', default='in.coeffs')
+    args = parser.parse_args()
+
+    chains = []
+    for filename, copies in args.seq:
+        seqs = hps.read_sequences(filename)
+        if not seqs:
+            sys.exit(f'No sequence in {filename}')
+        for _ in range(int(copies)):
+            chains.extend(seqs)
+
+    top = hps.Topology(chains, epsd=args.epsd, per_dihedral=args.per_dihedral)
+
+    # grow conformations in parallel, one seed per chain
+    jobs = [(len(c), args.bond, args.dmin, args.seed + 7919*m) for m, c in enumerate(chains)]
+    with multiprocessing.Pool(args.nproc) as pool:
+        confs = pool.map(saw, jobs, chunksize=max(1, len(jobs)//(4*args.nproc)))
+
+    box = Box(args.box, args.dmin)
+    zlo, zhi = args.slab if args.slab else (box.lo[2], box.lo[2] + box.length[2])
+    rng = random.Random(args.seed)
+    coords = []
+    for m, conf in enumerate(confs):
+        placed = None
+        for regrow in range(20):
+            for _ in range(args.tries):
+                com = (box.lo[0] + box.length[0]*rng.random(),
+                       box.lo[1] + box.length[1]*rng.random(),
+                       zlo + (zhi - zlo)*rng.random())
+                placed = box.insert(conf, random_rotation(rng), com)
+                if placed:
+                    break
+            if placed:
+                break
+            conf = saw((len(conf), args.bond, args.dmin, rng.randrange(1 << 30)))
+        if not placed:
+            sys.exit(f'Could not place chain {m+1}: box or slab too dense')
+        coords.append(placed)
+
+    write_data(args.out, top, box, coords)
+    with open(args.coeffs, 'w') as fout:
+        top.write_coeffs(fout)
+
+    print(f'{len(chains)} chains, {len(box.x)} atoms, {len(top.residues)} atom types, '
+          f'{len(top.dihedral_values)} dihedral types -> {args.out}, {args.coeffs}')
+
+
+if __name__ == '__main__':
+    main()
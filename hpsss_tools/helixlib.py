@@ -0,0 +1,180 @@
+"""NumPy bindings of helix_lib.f90 (helix assignment and Lifson-Roig routines).
+
+Coordinates are [frames, N, 3] float64 arrays in C order (a single [N, 3]
+frame is accepted too); such arrays, and the other float64/int32 inputs, are
+handed to the library as they are, without a copy.  Other dtypes or
+non-contiguous views are converted once.  Frames are split over OpenMP
+threads (OMP_NUM_THREADS, or set_threads()).
+
+build the library at the top of the repository:
+  gfortran -O2 -fopenmp -fPIC -shared -o libhelix.so helix_lib.f90
+it is looked up in $HPSSS_HELIXLIB, then next to this directory
+
+example, (i,i+4) rule of HelixFracDihed15 -dihed 0.25 1.7 -nn 3 010:
+  import helixlib
+  part = helixlib.assign_i4(x, box, dihed=(0.25, 1.7), nn='010')
+  helix = part.mean(axis=0)
+"""
+import ctypes
+import os
+
+import numpy as np
+from numpy.ctypeslib import ndpointer
+
+_lib = None
+
+
+def _f64(a):
+    return np.ascontiguousarray(a, dtype=np.float64)
+
+
+def _i32(a):
+    return np.ascontiguousarray(a, dtype=np.int32)
+
+
+def library():
+    """Load libhelix.so once and declare the argument types."""
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = os.environ.get('HPSSS_HELIXLIB')
+    if not path:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir,
+                            'libhelix.so')
+    lib = ctypes.CDLL(path)
+
+    f64 = ndpointer(np.float64, flags='C_CONTIGUOUS')
+    i32 = ndpointer(np.int32, flags='C_CONTIGUOUS')
+    i8 = ndpointer(np.int8, flags='C_CONTIGUOUS')
+    cint = ctypes.c_int
+    cdbl = ctypes.c_double
+
+    lib.hl_set_threads.argtypes = [cint]
+    lib.hl_dihedrals.argtypes = [cint, cint, f64, f64, f64]
+    lib.hl_assign_i4.argtypes = [cint, cint, f64, f64, cint, f64, f64, cint, i32, i8]
+    lib.hl_assign_i12.argtypes = [cint, cint, f64, f64, cint, f64, f64, i32, cint, i8]
+    lib.hl_counts.argtypes = [cint, cint, i8, cint, i32, f64, f64, f64, f64]
+    lib.hl_helix_fraction.argtypes = [cint, cint, f64, f64, i32, f64]
+    lib.hl_log_likelihood.argtypes = [cint, cdbl, cint, cint, f64, f64, f64, f64, i32, f64]
+    for f in (lib.hl_set_threads, lib.hl_dihedrals, lib.hl_assign_i4, lib.hl_assign_i12,
+              lib.hl_counts, lib.hl_helix_fraction, lib.hl_log_likelihood):
+        f.restype = None
+    _lib = lib
+    return lib
+
+
+def set_threads(n):
+    library().hl_set_threads(int(n))
+
+
+def _frames(x, box):
+    """[frames, N, 3] coordinates and [frames, 3] box (0 = not periodic)."""
+    x = _f64(x)
+    if x.ndim == 2:
+        x = x[np.newaxis]
+    if x.ndim != 3 or x.shape[2] != 3:
+        raise ValueError('coordinates must have shape [frames, N, 3]')
+    if box is None:
+        box = np.zeros((x.shape[0], 3))
+    else:
+        box = np.asarray(box, dtype=np.float64)
+        if box.ndim == 0:
+            box = np.full(3, float(box))
+        box = _f64(np.broadcast_to(box, (x.shape[0], 3)))
+    return x, box
+
+
+def _ranges(dihed):
+    """-dihed lo hi [lo hi ...] as [nrange, 2]."""
+    d = _f64(dihed).reshape(-1, 2)
+    return d, d.shape[0]
+
+
+def dihedrals(x, box=None, out=None):
+    """Dihedrals (i, i+1, i+2, i+3) of every frame, [frames, N-3] (rad)."""
+    x, box = _frames(x, box)
+    nframe, natom = x.shape[:2]
+    if out is None:
+        out = np.empty((nframe, max(natom-3, 0)))
+    library().hl_dihedrals(nframe, natom, x, box, out)
+    return out
+
+
+def assign_i4(x, box=None, dihed=(0.25, 1.7), r14=(0.0, 100.0), nn='010', out=None):
+    """(i,i+4) rule of HelixFracDihed15 (-dihed, -r14, -nn n hhh with n = len(nn)).
+
+    Returns int8 [frames, N], 1 = residue is part of a helix.
+    """
+    x, box = _frames(x, box)
+    nframe, natom = x.shape[:2]
+    d, nd = _ranges(dihed)
+    hhh = _i32([c == '1' for c in nn])
+    if out is None:
+        out = np.empty((nframe, natom), dtype=np.int8)
+    library().hl_assign_i4(nframe, natom, x, box, nd, d, _f64(r14), len(hhh), hhh, out)
+    return out
+
+
+def assign_i12(x, box=None, dihed=(0.25, 1.3), r14=(0.0, 100.0), assign='0110', nn=1,
+               out=None):
+    """(i+1,i+2) rule of HelixPropensity (-dihed, -r14, -assign, -nn).
+
+    Returns int8 [frames, N], 1 = residue is part of a helix.
+    """
+    x, box = _frames(x, box)
+    nframe, natom = x.shape[:2]
+    d, nd = _ranges(dihed)
+    hassign = _i32([c == '1' for c in assign.ljust(4, '0')[:4]])
+    if out is None:
+        out = np.empty((nframe, natom), dtype=np.int8)
+    library().hl_assign_i12(nframe, natom, x, box, nd, d, _f64(r14), hassign, int(nn), out)
+    return out
+
+
+def counts(part, idconf, nconf=None, weights=None):
+    """Weighted helix counts of HelixPropensity from assignments [frames, N].
+
+    Returns (hsum [N], nv [nconf], nw [nconf]); hsum/sum(weights) is the
+    helix fraction, nv/nw go to log_likelihood.
+    """
+    part = np.ascontiguousarray(part, dtype=np.int8)
+    if part.ndim == 1:
+        part = part[np.newaxis]
+    nframe, natom = part.shape
+    idconf = _i32(idconf)
+    if nconf is None:
+        nconf = int(idconf.max()) + 1
+    wgt = np.ones(nframe) if weights is None else _f64(weights)
+    hsum = np.zeros(natom)
+    nv = np.zeros(nconf)
+    nw = np.zeros(nconf)
+    library().hl_counts(nframe, natom, part, nconf, idconf, wgt, hsum, nv, nw)
+    return hsum, nv, nw
+
+
+def helix_fraction(w, v, idconf):
+    """Lifson-Roig helix fraction of every residue (HelixFraction)."""
+    w = _f64(w)
+    v = _f64(v)
+    idconf = _i32(idconf)
+    h = np.empty(idconf.shape[0])
+    library().hl_helix_fraction(idconf.shape[0], w.shape[0], w, v, idconf, h)
+    return h
+
+
+def log_likelihood(nc, nv, nw, lv, lw, idconf):
+    """LogLikelihood of HelixPropensity; lv, lw = ln v, ln w of shape [m]
+    or [sets, m] (one value per set, evaluated in parallel)."""
+    lv = _f64(lv)
+    lw = _f64(lw)
+    single = lv.ndim == 1
+    lv = lv.reshape(-1, lv.shape[-1])
+    lw = lw.reshape(-1, lw.shape[-1])
+    if lw.shape != lv.shape:
+        raise ValueError('lv and lw must have the same shape')
+    idconf = _i32(idconf)
+    nset, m = lv.shape
+    y = np.empty(nset)
+    library().hl_log_likelihood(nset, float(nc), idconf.shape[0], m, _f64(nv), _f64(nw),
+                                lv, lw, idconf, y)
+    return y[0] if single else y
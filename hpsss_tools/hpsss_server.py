@@ -0,0 +1,276 @@
+"""Long-lived HPS-SS server: one-letter sequence in, helicity and Rg out.
+
+One LAMMPS instance is kept per chain length (20 residue atom types, one
+dihedral type per dihedral, as in screen_variants.py), so a request only
+scatters types/charges, re-issues the changed dihedral_coeff, minimizes the
+stored start for the new types and runs. Helicity (the (i,i+4) rule of
+HelixFracDihed15) and Rg are evaluated in place every `every` steps, nothing
+is written to disk.
+
+requests, one JSON object per line (missing keys take the command-line values):
+  {"name": "fus_wt", "sequence": "MASNDYTQQATQSYG...", "steps": 2000000,
+   "eq": 200000, "every": 1000, "temp": 300.0, "seed": 11}
+replies, one JSON object per line:
+  {"name": "fus_wt", "nres": 163, "nframes": 1800, "helix": [...],
+   "helix_mean": 0.012, "rg": 33.1, "rg_std": 4.2, "wall": 95.3}
+  {"name": "...", "error": "..."}
+
+usage (needs the LAMMPS python module built with the HPS-SS styles):
+  python3 hpsss_server.py < requests.jsonl > replies.jsonl
+  python3 hpsss_server.py --socket /tmp/hpsss.sock &
+"""
+import argparse
+import collections
+import ctypes
+import json
+import math
+import os
+import socketserver
+import sys
+import time
+
+import hpsss_topology as hps
+import screen_variants as screen
+
+
+def dihedral(x1, x2, x3, x4):
+    """Same convention as ComputeDihedral in HelixFracDihed15.f90."""
+    def sub(a, b):
+        return [a[0]-b[0], a[1]-b[1], a[2]-b[2]]
+
+    def cross(a, b):
+        return [a[1]*b[2]-a[2]*b[1], a[2]*b[0]-a[0]*b[2], a[0]*b[1]-a[1]*b[0]]
+
+    def dot(a, b):
+        return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]
+
+    b1 = sub(x2, x1)
+    b2 = sub(x2, x3)
+    b3 = sub(x4, x3)
+    n1 = cross(b1, b2)
+    n2 = cross(b2, b3)
+    m = cross(n1, b2)
+    rn1 = math.sqrt(dot(n1, n1))
+    rn2 = math.sqrt(dot(n2, n2))
+    rm = math.sqrt(dot(m, m))
+    return math.atan2(dot(m, n2)/(rm*rn2), dot(n1, n2)/(rn1*rn2))
+
+
+class Helicity:
+    """(i,i+4) helix rule: -dihed ranges, -r14 range, -nn pattern."""
+
+    def __init__(self, dihed, r14, pattern):
+        self.dihed = [(dihed[k], dihed[k+1]) for k in range(0, len(dihed), 2)]
+        self.r14 = r14
+        self.pattern = [c == '1' for c in pattern]
+
+    def __call__(self, x):
+        n = len(x)
+        h = [0]*n
+        for i in range(n-4):
+            d1 = dihedral(x[i], x[i+1], x[i+2], x[i+3])
+            d2 = dihedral(x[i+1], x[i+2], x[i+3], x[i+4])
+            r14 = math.dist(x[i], x[i+4])
+            helical = all(lo <= d1 <= hi and lo <= d2 <= hi for lo, hi in self.dihed)
+            if helical and self.r14[0] <= r14 <= self.r14[1]:
+                h[i] = h[i+4] = 1
+        nn = len(self.pattern)
+        part = [0]*n
+        for i in range(n-nn+1):
+            if sum(h[i:i+nn]) == nn:
+                for j in range(nn):
+                    if self.pattern[j]:
+                        part[i+j] = 1
+        return part
+
+
+def radius_of_gyration(x):
+    n = len(x)
+    cm = [sum(p[d] for p in x)/n for d in range(3)]
+    return math.sqrt(sum((p[0]-cm[0])**2 + (p[1]-cm[1])**2 + (p[2]-cm[2])**2
+                         for p in x)/n)
+
+
+class Session:
+    """Initialized LAMMPS instance for chains of one length."""
+
+    def __init__(self, chain, args, tag):
+        residues = sorted(hps.mass, key=lambda r: hps.mass[r])
+        self.top = hps.Topology([chain], epsd=args.epsd, per_dihedral=True,
+                                residues=residues)
+        self.box = args.box
+        data = os.path.join(args.workdir, f'server_{tag}.data')
+        log = os.path.join(args.workdir, f'server_{tag}.log')
+        self.lmp = screen.start_lammps(self.top, chain, args.box, args.seed,
+                                       args.dt, data, log)
+        self.x0 = self.lmp.gather_atoms('x', 1, 3)
+        self.image0 = self.lmp.gather_atoms('image', 0, 1)
+        self.eps_d = list(self.top.dihedral_values)
+
+    def unwrapped(self):
+        """Chain coordinates, unwrapped bond by bond (minimum image)."""
+        n = len(self.x0)//3
+        xw = self.lmp.gather_atoms('x', 1, 3)
+        x = [[xw[0], xw[1], xw[2]]]
+        for i in range(1, n):
+            p = x[-1]
+            d = [xw[3*i+k] - p[k] for k in range(3)]
+            x.append([p[k] + d[k] - self.box*round(d[k]/self.box) for k in range(3)])
+        return x
+
+    def close(self):
+        self.lmp.close()
+
+
+class Server:
+    def __init__(self, args):
+        self.args = args
+        self.helicity = Helicity(args.dihed, args.r14, args.nn)
+        self.sessions = collections.OrderedDict()
+        self.ntag = 0
+
+    def session(self, chain):
+        """Instance for this chain length, least recently used one is closed."""
+        n = len(chain)
+        if n in self.sessions:
+            self.sessions.move_to_end(n)
+            return self.sessions[n]
+        if len(self.sessions) >= self.args.sessions:
+            _, old = self.sessions.popitem(last=False)
+            old.close()
+        self.ntag += 1
+        self.sessions[n] = Session(chain, self.args, self.ntag)
+        return self.sessions[n]
+
+    def run(self, req):
+        a = self.args
+        if not isinstance(req, dict):
+            return {'error': 'bad request: not a JSON object'}
+        name = req.get('name', '')
+        seq = req.get('sequence', '')
+        if not isinstance(seq, str):
+            return {'name': name, 'error': 'invalid sequence'}
+        seq = seq.upper()
+        bad = sorted(set(c for c in seq if c not in hps.seq))
+        if len(seq) < 5 or bad:
+            return {'name': name, 'error': f'invalid sequence {"".join(bad)}'}
+        chain = [hps.seq[c] for c in seq]
+        try:
+            steps = int(req.get('steps', a.steps))
+            eq = int(req.get('eq', a.eq))
+            every = int(req.get('every', a.every))
+            temp = float(req.get('temp', a.temp))
+            seed = int(req.get('seed', a.seed))
+        except (TypeError, ValueError) as e:
+            return {'name': name, 'error': f'bad request: {e}'}
+        if steps < 0 or eq < 0 or every < 1 or not temp > 0.0 or seed < 1:
+            return {'name': name, 'error': 'bad request: steps, eq >= 0, every, seed >= 1, temp > 0'}
+
+        t0 = time.time()
+        try:
+            s = self.session(chain)
+        except Exception as e:
+            return {'name': name, 'error': f'cannot start LAMMPS: {e}'}
+        lmp = s.lmp
+        try:
+            screen.set_sequence(lmp, s.top, chain, s.eps_d)
+            lmp.scatter_atoms('x', 1, 3, s.x0)
+            lmp.scatter_atoms('image', 0, 1, s.image0)
+            lmp.command(screen.MINIMIZE)
+            lmp.command('reset_timestep 0')
+            lmp.command(f'velocity all create {temp} {seed} mom yes rot yes')
+            lmp.command(f'fix 1 all langevin {temp} {temp} {a.damp} {seed}')
+            lmp.command(f'run {eq}')
+
+            hsum = [0.0]*len(chain)
+            rg = []
+            for _ in range(steps//every):
+                lmp.command(f'run {every} pre no post no')
+                x = s.unwrapped()
+                for i, h in enumerate(self.helicity(x)):
+                    hsum[i] += h
+                rg.append(radius_of_gyration(x))
+            lmp.command('unfix 1')
+        except Exception as e:
+            # the instance may be left in an undefined state
+            self.sessions.pop(len(chain)).close()
+            return {'name': name, 'error': str(e)}
+
+        nframes = len(rg)
+        helix = [h/nframes for h in hsum] if nframes else hsum
+        rgm = sum(rg)/nframes if nframes else 0.0
+        rgs = math.sqrt(sum((r-rgm)**2 for r in rg)/nframes) if nframes else 0.0
+        return {'name': name, 'nres': len(chain), 'nframes': nframes,
+                'helix': [round(h, 6) for h in helix],
+                'helix_mean': round(sum(helix)/len(helix), 6),
+                'rg': round(rgm, 4), 'rg_std': round(rgs, 4),
+                'wall': round(time.time()-t0, 3)}
+
+    def handle(self, line):
+        try:
+            req = json.loads(line)
+        except ValueError as e:
+            return {'error': f'bad request: {e}'}
+        return self.run(req)
+
+    def close(self):
+        for s in self.sessions.values():
+            s.close()
+        self.sessions.clear()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--socket', help='listen on this Unix socket instead of stdin')
+    parser.add_argument('--sessions', type=int, default=4,
+                        help='LAMMPS instances kept alive (one per chain length)')
+    parser.add_argument('--steps', type=int, default=1000000)
+    parser.add_argument('--eq', type=int, default=100000)
+    parser.add_argument('--every', type=int, default=1000)
+    parser.add_argument('--temp', type=float, default=300.0)
+    parser.add_argument('--dt', type=float, default=10.0)
+    parser.add_argument('--damp', type=float, default=1000.0)
+    parser.add_argument('--box', type=float, default=300.0)
+    parser.add_argument('--seed', type=int, default=4928421)
+    parser.add_argument('--epsd', help='eps_d table (default eps_d_i_i+4.txt)')
+    parser.add_argument('--dihed', type=float, nargs='+', default=[0.25, 1.7])
+    parser.add_argument('--r14', type=float, nargs=2, default=[0.0, 100.0])
+    parser.add_argument('--nn', default='010', help='helix pattern as in -nn of HelixFracDihed15')
+    parser.add_argument('--workdir', default='.', help='data and log files of the instances')
+    args = parser.parse_args()
+    if len(args.dihed) % 2:
+        sys.exit('--dihed takes pairs of values')
+
+    server = Server(args)
+
+    if args.socket is None:
+        for line in sys.stdin:
+            if line.strip():
+                print(json.dumps(server.handle(line)), flush=True)
+        server.close()
+        return
+
+    class Handler(socketserver.StreamRequestHandler):
+        def handle(self):
+            for line in self.rfile:
+                line = line.decode()
+                if line.strip():
+                    reply = json.dumps(server.handle(line)) + '\n'
+                    self.wfile.write(reply.encode())
+                    self.wfile.flush()
+
+    if os.path.exists(args.socket):
+        os.unlink(args.socket)
+    # one client at a time: the LAMMPS instances are not shared between threads
+    with socketserver.UnixStreamServer(args.socket, Handler) as srv:
+        try:
+            srv.serve_forever()
+        except KeyboardInterrupt:
+            pass
+    server.close()
+    os.unlink(args.socket)
+
+
+if __name__ == '__main__':
+    main()
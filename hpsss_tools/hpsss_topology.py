@@ -0,0 +1,136 @@
+"""HPS-SS topology helpers: sequences, residue tables and force field coefficients.
+
+Shared by gen_condensate.py and the other scripts in this directory.
+Tables default to the files at the top of the repository.
+"""
+import os
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+seq = {
+    'R': 'ARG', 'H': 'HIS', 'K': 'LYS', 'D': 'ASP', 'E': 'GLU',
+    'S': 'SER', 'T': 'THR', 'N': 'ASN', 'Q': 'GLN', 'C': 'CYS',
+    'U': 'SEC', 'G': 'GLY', 'P': 'PRO', 'A': 'ALA', 'V': 'VAL',
+    'I': 'ILE', 'L': 'LEU', 'M': 'MET', 'F': 'PHE', 'Y': 'TYR',
+    'W': 'TRP'
+}
+
+# residue masses (g/mol) and charges at pH 7, as in the validation data files
+mass = {
+    'GLY': 57.05, 'ALA': 71.08, 'SER': 87.08, 'PRO': 97.12, 'VAL': 99.07,
+    'THR': 101.10, 'CYS': 103.10, 'LEU': 113.20, 'ILE': 113.20, 'ASN': 114.10,
+    'ASP': 115.10, 'GLN': 128.10, 'LYS': 128.20, 'GLU': 129.10, 'MET': 131.20,
+    'HIS': 137.10, 'PHE': 147.20, 'ARG': 156.20, 'TYR': 163.20, 'TRP': 186.20
+}
+charge = {'ARG': 1.0, 'LYS': 1.0, 'ASP': -1.0, 'GLU': -1.0}
+
+# HPS-SS constants
+EPSILON = 0.2          # kcal/mol
+LAMBDA_SHIFT = 0.08    # lambda_ij = (lambda_i + lambda_j)/2 - shift
+CUT_COUL = 35.0        # DH cutoff for charged pairs
+BOND = (10.0, 3.8)     # harmonic bond k, r0
+EPS_A = 4.3            # angle_coeff of bch
+
+
+def read_table(filename):
+    """Two-column residue table (hydropathy, vdW diameter or eps_d)."""
+    table = {}
+    with open(filename, 'r') as fid:
+        for i in fid:
+            if i.startswith('#') or not i.strip():
+                continue
+            tmp = i.split()
+            table[tmp[0]] = float(tmp[1])
+    return table
+
+
+def read_sequences(filename):
+    """One-letter sequences, one chain per line, '#' lines are skipped.
+    Returns a list of three letter residue name lists."""
+    chains = []
+    with open(filename, 'r') as fid:
+        for i in fid:
+            if i.startswith('#') or i.startswith('>'):
+                continue
+            chain = [seq[j] for j in i.strip().upper() if j in seq]
+            if chain:
+                chains.append(chain)
+    return chains
+
+
+def dihedral_eps(chain, eps_d):
+    """eps_d of every dihedral of a chain, same mixing rule as compute_eps_d/eps_d.py:
+    average over the residues i-1, i, i+3, i+4 of dihedral (i,i+1,i+2,i+3)."""
+    dih_param = [eps_d[i] for i in chain]
+    ndih = len(chain) - 3
+    params = []
+    for n in range(ndih):
+        if ndih == 1:
+            params.append((dih_param[n] + dih_param[n+3])/2)
+        elif n == 0:
+            params.append((dih_param[n] + dih_param[n+3] + dih_param[n+4])/3)
+        elif n == ndih - 1:
+            params.append((dih_param[n-1] + dih_param[n] + dih_param[n+3])/3)
+        else:
+            params.append((dih_param[n-1] + dih_param[n] + dih_param[n+3] + dih_param[n+4])/4)
+    return [float(f'{x:.6f}') for x in params]
+
+
+class Topology:
+    """Atom and dihedral types of a set of chains.
+
+    Atom types are numbered in order of first appearance (or follow a given
+    residues list), dihedral types are the unique eps_d values in order of first
+    appearance (as in the validation decks), or one type per dihedral with
+    per_dihedral=True.
+    """
+
+    def __init__(self, chains, hydropathy=None, diameter=None, epsd=None,
+                 per_dihedral=False, residues=None):
+        self.chains = chains
+        self.hydropathy = read_table(hydropathy or os.path.join(ROOT, 'aminoacids_hydropathy.dat'))
+        self.diameter = read_table(diameter or os.path.join(ROOT, 'aminoacids_vdwdiameter.dat'))
+        self.eps_d = read_table(epsd or os.path.join(ROOT, 'eps_d_i_i+4.txt'))
+
+        self.residues = list(residues) if residues else []
+        for chain in chains:
+            for res in chain:
+                if res not in self.residues:
+                    self.residues.append(res)
+        self.atomtype = {res: n + 1 for n, res in enumerate(self.residues)}
+
+        self.dihedral_values = []
+        self.dihedral_types = []
+        lookup = {}
+        for chain in chains:
+            types = []
+            for x in dihedral_eps(chain, self.eps_d):
+                if per_dihedral or x not in lookup:
+                    self.dihedral_values.append(x)
+                    lookup[x] = len(self.dihedral_values)
+                    types.append(len(self.dihedral_values))
+                else:
+                    types.append(lookup[x])
+            self.dihedral_types.append(types)
+
+    def pair_coeff(self, i, j):
+        """eps sigma lambda cut_lj cut_coul of atom types i <= j."""
+        ri, rj = self.residues[i-1], self.residues[j-1]
+        sigma = 0.5*(self.diameter[ri] + self.diameter[rj])
+        lam = 0.5*(self.hydropathy[ri] + self.hydropathy[rj]) - LAMBDA_SHIFT
+        cut_coul = CUT_COUL if ri in charge and rj in charge else 0.0
+        return EPSILON, sigma, lam, 4.0*sigma, cut_coul
+
+    def write_coeffs(self, fout):
+        """bond/angle/dihedral/pair coefficients in the format of the validation decks."""
+        fout.write(f'bond_coeff          1   {BOND[0]:.6f}    {BOND[1]:.6f}\n\n')
+        fout.write(f'angle_coeff         1    {EPS_A:.6f}\n\n')
+        for n, x in enumerate(self.dihedral_values):
+            fout.write(f'dihedral_coeff     {n+1:3d}   {x:.6f}\n')
+        fout.write('\n')
+        ntypes = len(self.residues)
+        for i in range(1, ntypes + 1):
+            for j in range(i, ntypes + 1):
+                eps, sigma, lam, cut_lj, cut_coul = self.pair_coeff(i, j)
+                fout.write(f'pair_coeff        {i:3d}     {j:3d}       {eps:.6f}   {sigma:.3f}'
+                           f'    {lam:.6f}  {cut_lj:.3f}   {cut_coul:.3f}\n')
@@ -0,0 +1,167 @@
+"""Screen sequence variants of one IDP in a single LAMMPS process.
+
+All variants share one data file and one set of pair coefficients: atom types
+are the 20 residues in a fixed order and every dihedral has its own type.  For
+each variant only the per-atom types and charges are scattered into the running
+LAMMPS instance and dihedral_coeff is re-issued for the dihedrals whose eps_d
+changed, so nothing is re-parsed and the ljlambda tables are never rebuilt.
+
+variants file, one variant per line:
+  name  A12G,S15E          (point mutations of the wild type, 1-based)
+  name  MASQSNYGPQ...      (full sequence of the same length)
+
+usage (needs the LAMMPS python module built with the HPS-SS styles):
+  python3 screen_variants.py -w fus.dat -v variants.dat --steps 10000000 \
+      --cmd "dump d all xtc 1000 {name}.xtc" --cmd "dump_modify d unwrap yes"
+each --cmd is issued before the run of a variant ({name} is replaced) and the
+dumps/fixes it defines are removed afterwards
+"""
+import argparse
+import ctypes
+import re
+import sys
+
+import hpsss_topology as hps
+import gen_condensate as gen
+
+MUTATION = re.compile(r'^([A-Z])(\d+)([A-Z])$')
+
+# same energy minimization as the decks, the walk allows contacts below sigma
+MINIMIZE = 'minimize 1.0e-4 1.0e-6 1000 100000'
+
+
+def read_variants(filename, wt):
+    variants = []
+    with open(filename, 'r') as fid:
+        for i in fid:
+            if i.startswith('#') or not i.strip():
+                continue
+            name, spec = i.split()[:2]
+            spec = spec.upper()
+            muts = spec.split(',')
+            if all(MUTATION.match(m) for m in muts):
+                chain = list(wt)
+                for m in muts:
+                    old, pos, new = MUTATION.match(m).groups()
+                    pos = int(pos) - 1
+                    if pos >= len(chain) or chain[pos] != hps.seq[old]:
+                        sys.exit(f'{name}: {m} does not match the wild type')
+                    chain[pos] = hps.seq[new]
+            else:
+                chain = [hps.seq[j] for j in spec if j in hps.seq]
+                if len(chain) != len(wt):
+                    sys.exit(f'{name}: length {len(chain)} differs from the wild type')
+            variants.append((name, chain))
+    return variants
+
+
+def start_lammps(top, chain, boxl, seed, dt, data, log='screen.log'):
+    """LAMMPS instance with chain as a minimized self-avoiding walk in a cubic box."""
+    from lammps import lammps
+
+    box = gen.Box([boxl]*3, 4.0)
+    conf = gen.saw((len(chain), hps.BOND[1], 4.0, seed))
+    coords = [[box.wrap(p) for p in conf]]
+    gen.write_data(data, top, box, coords)
+    coeffs = data + '.coeffs'
+    with open(coeffs, 'w') as fout:
+        top.write_coeffs(fout)
+
+    lmp = lammps(cmdargs=['-log', log, '-screen', 'none'])
+    for c in ('units real', 'dimension 3', 'boundary p p p', 'atom_style full',
+              'bond_style harmonic', 'angle_style bch', 'dihedral_style gaussian',
+              'pair_style ljlambda 0.1 0.0 35.0', 'dielectric 80.0',
+              f'read_data {data}', f'include {coeffs}',
+              'special_bonds lj/coul 0.0 0.0 0.0',
+              'neighbor 3.5 multi', 'neigh_modify every 10 delay 0',
+              MINIMIZE, 'reset_timestep 0',
+              f'timestep {dt}', 'fix 2 all nve'):
+        lmp.command(c)
+    return lmp
+
+
+def set_sequence(lmp, top, chain, eps_d):
+    """Scatter types and charges of chain, re-issue the changed dihedral_coeff.
+
+    eps_d holds the current value of every dihedral type and is updated.
+    """
+    natoms = len(chain)
+    types = (ctypes.c_int*natoms)(*[top.atomtype[r] for r in chain])
+    q = (ctypes.c_double*natoms)(*[hps.charge.get(r, 0.0) for r in chain])
+    lmp.scatter_atoms('type', 0, 1, types)
+    lmp.scatter_atoms('q', 1, 1, q)
+
+    new = hps.dihedral_eps(chain, top.eps_d)
+    for k, x in enumerate(new):
+        if x != eps_d[k]:
+            lmp.command(f'dihedral_coeff {k+1} {x:.6f}')
+            eps_d[k] = x
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-w', '--wt', required=True, help='wild type one-letter sequence file')
+    parser.add_argument('-v', '--variants', required=True)
+    parser.add_argument('--steps', type=int, default=1000000)
+    parser.add_argument('--temp', type=float, default=300.0)
+    parser.add_argument('--dt', type=float, default=10.0)
+    parser.add_argument('--damp', type=float, default=1000.0)
+    parser.add_argument('--box', type=float, default=300.0)
+    parser.add_argument('--seed', type=int, default=4928421)
+    parser.add_argument('--epsd', help='eps_d table (default eps_d_i_i+4.txt)')
+    parser.add_argument('--cmd', action='append', default=[],
+                        help='LAMMPS command issued per variant, {name} is substituted')
+    parser.add_argument('--data', default='screen.data', help='reference data file to write')
+    args = parser.parse_args()
+
+    wt = hps.read_sequences(args.wt)[0]
+    variants = read_variants(args.variants, wt)
+    residues = sorted(hps.mass, key=lambda r: hps.mass[r])
+    top = hps.Topology([wt], epsd=args.epsd, per_dihedral=True, residues=residues)
+
+    # reference data file: wild type as a self-avoiding walk in a cubic box
+
+    lmp = start_lammps(top, wt, args.box, args.seed, args.dt, args.data)
+
+    x0 = lmp.gather_atoms('x', 1, 3)
+    image0 = lmp.gather_atoms('image', 0, 1)
+    ntypes = len(top.residues)
+    eps_d = list(top.dihedral_values)
+
+    for n, (name, chain) in enumerate(variants):
+        # per-atom types and charges in place, only the changed dihedral_coeff
+
+        set_sequence(lmp, top, chain, eps_d)
+
+        # same starting conformation (coordinates and image flags), relaxed
+        # again for the new sigmas, fresh velocities and thermostat
+
+        lmp.scatter_atoms('x', 1, 3, x0)
+        lmp.scatter_atoms('image', 0, 1, image0)
+        lmp.command(MINIMIZE)
+        lmp.command('reset_timestep 0')
+        lmp.command(f'velocity all create {args.temp} {args.seed + n} mom yes rot yes')
+        lmp.command(f'fix 1 all langevin {args.temp} {args.temp} {args.damp} {args.seed + n}')
+
+        defined = []
+        for c in args.cmd:
+            c = c.format(name=name)
+            lmp.command(c)
+            words = c.split()
+            if words[0] in ('dump', 'fix', 'compute'):
+                defined.append((words[0], words[1]))
+
+        lmp.command(f'run {args.steps}')
+
+        for style, ID in reversed(defined):
+            lmp.command({'dump': 'undump', 'fix': 'unfix', 'compute': 'uncompute'}[style] + ' ' + ID)
+        lmp.command('unfix 1')
+        print(f'{name}: {args.steps} steps, {ntypes} atom types, '
+              f'{sum(1 for a, b in zip(chain, wt) if a != b)} mutations', flush=True)
+
+    lmp.close()
+
+
+if __name__ == '__main__':
+    main()